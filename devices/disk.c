@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -215,6 +216,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	ASSERT (buffer != NULL);
 
 	c = d->channel;
+	trace (TRACE_DISK_READ, TRACE_BEGIN, (c - channels) * 2 + d->dev_no, sec_no);
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
 	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
@@ -224,6 +226,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	input_sector (c, buffer);
 	d->read_cnt++;
 	lock_release (&c->lock);
+	trace (TRACE_DISK_READ, TRACE_END, (c - channels) * 2 + d->dev_no, sec_no);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -239,6 +242,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	ASSERT (buffer != NULL);
 
 	c = d->channel;
+	trace (TRACE_DISK_WRITE, TRACE_BEGIN, (c - channels) * 2 + d->dev_no, sec_no);
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
 	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
@@ -248,6 +252,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	sema_down (&c->completion_wait);
 	d->write_cnt++;
 	lock_release (&c->lock);
+	trace (TRACE_DISK_WRITE, TRACE_END, (c - channels) * 2 + d->dev_no, sec_no);
 }
 
 /* Disk detection and identification. */
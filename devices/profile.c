@@ -0,0 +1,243 @@
+#include "devices/profile.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* The profiler only sees code that runs with interrupts on.  Time
+   spent with interrupts off is charged to the instruction that
+   turned them back on. */
+
+/* Samples are counted per (rip, thread) pair in an open-addressed
+   table.  Must be a power of 2.  Samples that find the table full
+   are only counted in `dropped'. */
+#define PROFILE_SLOTS 4096
+
+/* Threads whose samples are counted separately.  Later threads
+   are only counted in the totals. */
+#define PROFILE_THREADS 64
+
+/* Kernel addresses printed at shutdown, most sampled first. */
+#define PROFILE_PRINT_MAX 256
+
+/* CMOS real-time clock ports and registers.  See [MC146818A]. */
+#define RTC_INDEX 0x70
+#define RTC_DATA 0x71
+#define RTC_NMI_OFF 0x80        /* Disables NMI while selecting. */
+#define RTC_REG_A 0x0a          /* Rate select in bits 0...3. */
+#define RTC_REG_B 0x0b
+#define RTC_REG_C 0x0c          /* Read to acknowledge an interrupt. */
+#define RTC_REG_D 0x0d          /* Read-only status; left selected when idle. */
+#define RTC_B_PIE 0x40          /* Periodic interrupt enable. */
+#define RTC_HZ_MIN 2
+#define RTC_HZ_MAX 8192
+
+/* Kernel command-line options. */
+bool profile_enabled;
+unsigned profile_hz;
+
+struct profile_slot {
+	uintptr_t rip;              /* Interrupted instruction. */
+	tid_t tid;                  /* Interrupted thread. */
+	uint32_t count;             /* Samples, 0 if slot unused. */
+};
+
+struct profile_thread {
+	tid_t tid;
+	char name[16];
+	uint64_t kernel;            /* Samples in kernel mode. */
+	uint64_t user;              /* Samples in user mode. */
+};
+
+static struct profile_slot slots[PROFILE_SLOTS];
+static struct profile_thread threads[PROFILE_THREADS];
+static size_t thread_cnt;
+static uint64_t kernel_samples, user_samples, dropped_samples;
+
+static intr_handler_func rtc_interrupt;
+static void rtc_write (uint8_t reg, uint8_t value);
+static uint8_t rtc_read (uint8_t reg);
+static void count_thread (struct thread *, bool user);
+static int compare_rip (const void *, const void *, void *aux);
+static int compare_count (const void *, const void *, void *aux);
+
+/* Starts the profiler, if enabled.  With a sampling rate of its
+   own, programs the RTC's periodic interrupt; otherwise
+   timer_interrupt() calls profile_sample() on every tick. */
+void
+profile_init (void) {
+	unsigned rate;
+
+	if (!profile_enabled || profile_hz == 0)
+		return;
+
+	if (profile_hz < RTC_HZ_MIN)
+		profile_hz = RTC_HZ_MIN;
+	if (profile_hz > RTC_HZ_MAX)
+		profile_hz = RTC_HZ_MAX;
+	profile_hz = 1u << (31 - __builtin_clz (profile_hz));
+
+	/* The RTC interrupts 32768 >> (RATE - 1) times per second. */
+	rate = 16 - (31 - __builtin_clz (profile_hz));
+	rtc_write (RTC_REG_A, (rtc_read (RTC_REG_A) & 0xf0) | rate);
+	rtc_write (RTC_REG_B, rtc_read (RTC_REG_B) | RTC_B_PIE);
+	rtc_read (RTC_REG_C);
+	intr_register_ext (0x28, rtc_interrupt, "RTC Profiler");
+}
+
+/* Records the instruction interrupted by F against the running
+   thread.  Called from an external interrupt handler. */
+void
+profile_sample (const struct intr_frame *f) {
+	struct thread *t = thread_current ();
+	bool user = (f->cs & 3) == 3;
+	size_t idx, i;
+
+	ASSERT (intr_context ());
+
+	if (user)
+		user_samples++;
+	else
+		kernel_samples++;
+	count_thread (t, user);
+
+	/* Canonical addresses fit in 48 bits, so the tid goes above
+	   them, and both reach the top bits through the multiply. */
+	idx = ((f->rip ^ (uint64_t) t->tid << 48) * 0x9e3779b97f4a7c15ULL) >> 52;
+	for (i = 0; i < PROFILE_SLOTS; i++) {
+		struct profile_slot *s = &slots[(idx + i) & (PROFILE_SLOTS - 1)];
+
+		if (s->count == 0) {
+			s->rip = f->rip;
+			s->tid = t->tid;
+		}
+		if (s->rip == f->rip && s->tid == t->tid) {
+			s->count++;
+			return;
+		}
+	}
+	dropped_samples++;
+}
+
+/* Prints the profile: per-thread totals, then the most sampled
+   kernel addresses summed over all threads.  `utils/backtrace -p'
+   folds the addresses into functions. */
+void
+profile_print_stats (void) {
+	static struct profile_slot rows[PROFILE_SLOTS];
+	enum intr_level old_level;
+	uint64_t shown = 0;
+	size_t cnt = 0, merged = 0;
+	size_t i;
+
+	if (!profile_enabled)
+		return;
+
+	old_level = intr_disable ();
+	for (i = 0; i < PROFILE_SLOTS; i++)
+		if (slots[i].count != 0 && is_kernel_vaddr (slots[i].rip))
+			rows[cnt++] = slots[i];
+	intr_set_level (old_level);
+
+	/* Sum each address over all threads. */
+	sort (rows, cnt, sizeof *rows, compare_rip, NULL);
+	for (i = 0; i < cnt; i++)
+		if (merged > 0 && rows[merged - 1].rip == rows[i].rip)
+			rows[merged - 1].count += rows[i].count;
+		else
+			rows[merged++] = rows[i];
+	sort (rows, merged, sizeof *rows, compare_count, NULL);
+
+	printf ("Profile: %llu kernel, %llu user samples at %u Hz, %llu dropped\n",
+	        kernel_samples, user_samples,
+	        profile_hz != 0 ? profile_hz : TIMER_FREQ, dropped_samples);
+	for (i = 0; i < thread_cnt; i++)
+		printf ("Profile: tid %d (%s): %llu kernel, %llu user\n",
+		        threads[i].tid, threads[i].name, threads[i].kernel, threads[i].user);
+	printf ("Profile: top kernel addresses (fold with `backtrace -p'):\n");
+	for (i = 0; i < merged && i < PROFILE_PRINT_MAX; i++) {
+		printf ("  %#018llx %10u\n", (uint64_t) rows[i].rip, rows[i].count);
+		shown += rows[i].count;
+	}
+	if (kernel_samples > shown)
+		printf ("  %-18s %10llu\n", "(other)", kernel_samples - shown);
+}
+
+/* RTC periodic interrupt handler. */
+static void
+rtc_interrupt (struct intr_frame *f) {
+	profile_sample (f);
+
+	/* The RTC raises no further interrupts until register C has
+	   been read. */
+	rtc_read (RTC_REG_C);
+}
+
+/* Writes VALUE to RTC register REG.  NMI is disabled only for
+   the access itself. */
+static void
+rtc_write (uint8_t reg, uint8_t value) {
+	outb (RTC_INDEX, RTC_NMI_OFF | reg);
+	outb (RTC_DATA, value);
+	outb (RTC_INDEX, RTC_REG_D);
+}
+
+/* Returns the value of RTC register REG.  NMI is disabled only
+   for the access itself. */
+static uint8_t
+rtc_read (uint8_t reg) {
+	uint8_t value;
+
+	outb (RTC_INDEX, RTC_NMI_OFF | reg);
+	value = inb (RTC_DATA);
+	outb (RTC_INDEX, RTC_REG_D);
+	return value;
+}
+
+/* Charges one sample to thread T. */
+static void
+count_thread (struct thread *t, bool user) {
+	struct profile_thread *pt = NULL;
+	size_t i;
+
+	for (i = 0; i < thread_cnt; i++)
+		if (threads[i].tid == t->tid) {
+			pt = &threads[i];
+			break;
+		}
+	if (pt == NULL) {
+		if (thread_cnt >= PROFILE_THREADS)
+			return;
+		pt = &threads[thread_cnt++];
+		pt->tid = t->tid;
+		strlcpy (pt->name, t->name, sizeof pt->name);
+	}
+	if (user)
+		pt->user++;
+	else
+		pt->kernel++;
+}
+
+/* Orders slots by address. */
+static int
+compare_rip (const void *a_, const void *b_, void *aux UNUSED) {
+	const struct profile_slot *a = a_;
+	const struct profile_slot *b = b_;
+
+	return a->rip < b->rip ? -1 : a->rip > b->rip;
+}
+
+/* Orders slots by sample count, highest first. */
+static int
+compare_count (const void *a_, const void *b_, void *aux UNUSED) {
+	const struct profile_slot *a = a_;
+	const struct profile_slot *b = b_;
+
+	return a->count > b->count ? -1 : a->count < b->count;
+}
@@ -3,11 +3,15 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include <vclock.h>
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/fixed-point.h"
+#include "devices/profile.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -25,7 +29,94 @@ static int64_t os_ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Hierarchical timing wheel.
+   Level L has WHEEL_SIZE slots, each covering WHEEL_SIZE^L ticks.
+   A timer due within WHEEL_SIZE ticks sits in level 0, in the
+   slot for its exact tick.  Timers further away sit in a higher
+   level and are cascaded one level down whenever the lower level
+   wraps around, so every timer is moved at most WHEEL_LEVELS
+   times before it expires.  Timers beyond the top level wait in
+   wheel_overflow. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static struct list wheel_overflow;
+static int64_t wheel_ticks;     /* Next tick to be processed. */
+static size_t wheel_cnt;        /* # of pending timers. */
+
+/* If true, the periodic tick is stopped while the idle thread
+   runs.  Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* Clock source for timer_ns().  Controlled by kernel
+   command-line option "-clock". */
+enum timer_clock timer_clock;
+
+/* TSC calibration, measured by timer_calibrate() against
+   TSC_CALIBRATE_TICKS timer ticks.  The TSC read TSC_BASE at
+   TSC_NS_BASE ns after boot, and a TSC delta D is
+   (D * tsc_mult) >> TSC_SHIFT ns.  TSC_HZ is 0 until then. */
+#define TSC_CALIBRATE_TICKS 5
+#define TSC_SHIFT 24
+static uint64_t tsc_hz;
+static uint64_t tsc_mult;
+static uint64_t tsc_base;
+static int64_t tsc_ns_base;
+
+/* Sub-tick sleeps.  A sleeper shorter than a tick blocks on
+   hrsleepers, ordered by deadline, and counter 0 is switched to
+   one-shot mode to interrupt at the earliest deadline.  Sleeps
+   shorter than SPIN_NS spin on timer_ns() instead, because
+   blocking and being woken costs about as much. */
+#define SPIN_NS 20000
+struct hrsleeper {
+	struct list_elem elem;      /* Element in hrsleepers. */
+	int64_t deadline;           /* timer_ns() to wake up at. */
+	struct thread *thread;      /* Sleeper, null once woken. */
+};
+static struct list hrsleepers;
+
+/* Clock page mapped read-only into every user process. */
+static struct vclock *vclock;
+
+/* 8254 input frequency and the count for one timer tick,
+   rounded to nearest. */
+#define PIT_HZ 1193180
+#define PIT_COUNT_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Tickless idle state.  The 8254 counter is only 16 bits wide,
+   so a single one-shot covers at most PIT_MAX_TICKS ticks; longer
+   idle periods are covered by several one-shots in a row. */
+#define PIT_MAX_TICKS (0xffff / PIT_COUNT_PER_TICK)
+
+/* Shortest one-shot, about 10 us, so that a deadline that has
+   just passed does not interrupt again before the handler
+   returns. */
+#define PIT_MIN_COUNT 12
+static bool pit_oneshot;            /* Counter 0 in one-shot mode? */
+static unsigned pit_oneshot_count;  /* Count loaded for the one-shot. */
+static unsigned pit_residual;       /* PIT cycles since the last counted tick
+                                       when the counter was last loaded. */
+static int64_t skipped_ticks;       /* Ticks with no timer interrupt. */
+
 static intr_handler_func timer_interrupt;
+static void timer_do_tick(void);
+static void pit_set_periodic(void);
+static void pit_set_oneshot(unsigned count);
+static unsigned pit_read(void);
+static bool pit_irq_pending(void);
+static bool pit_sync(void);
+static void pit_reprogram(void);
+static int64_t pit_ns(void);
+static void hrsleep(int64_t ns);
+static void hrsleep_run(void);
+static void vclock_publish(void);
+static void wheel_insert(struct timer *t, bool front);
+static void wheel_reinsert(struct list *slot);
+static int wheel_cascade(int level, int idx);
+static void wheel_run(int64_t now);
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
@@ -35,21 +126,28 @@ static void real_time_sleep(int64_t num, int32_t denom);
    corresponding interrupt. */
 void timer_init(void)
 {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	pit_set_periodic();
 
-	outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb(0x40, count & 0xff);
-	outb(0x40, count >> 8);
+	for (int l = 0; l < WHEEL_LEVELS; l++)
+		for (int i = 0; i < WHEEL_SIZE; i++)
+			list_init(&wheel[l][i]);
+	list_init(&wheel_overflow);
+	wheel_ticks = os_ticks + 1;
+	list_init(&hrsleepers);
+	vclock = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+	vclock_publish();
 
 	intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays,
+   and the TSC rate, used by timer_ns(). */
 void timer_calibrate(void)
 {
 	unsigned high_bit, test_bit;
+	uint64_t tsc_start, tsc_end;
+	int64_t start;
+	enum intr_level old_level;
 
 	ASSERT(intr_get_level() == INTR_ON);
 	printf("Calibrating timer...  ");
@@ -70,6 +168,26 @@ void timer_calibrate(void)
 			loops_per_tick |= test_bit;
 
 	printf("%'" PRIu64 " loops/s.\n", (uint64_t)loops_per_tick * TIMER_FREQ);
+
+	/* Count TSC cycles between two tick edges. */
+	start = os_ticks;
+	while (os_ticks == start)
+		barrier();
+	tsc_start = rdtsc();
+	start = os_ticks;
+	while (os_ticks - start < TSC_CALIBRATE_TICKS)
+		barrier();
+	tsc_end = rdtsc();
+
+	tsc_base = tsc_end;
+	tsc_ns_base = (start + TSC_CALIBRATE_TICKS) * TIMER_NS_PER_TICK;
+	tsc_mult = ((uint64_t)1000000000 << TSC_SHIFT) * TSC_CALIBRATE_TICKS / TIMER_FREQ / (tsc_end - tsc_start);
+	barrier();
+	tsc_hz = (tsc_end - tsc_start) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+
+	old_level = intr_disable();
+	vclock_publish();
+	intr_set_level(old_level);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -89,7 +207,47 @@ int64_t timer_elapsed(int64_t then)
 	return timer_ticks() - then;
 }
 
-/* timer_sleep() - 현재 스레드를 ticks만큼 BLOCKED 상태로 만들고, wakeup_tick 내림차순으로 sleep_list에 삽입한다.
+/* Returns the number of nanoseconds since the OS booted, read
+   from the clock source selected by timer_clock. */
+int64_t timer_ns(void)
+{
+	if (tsc_hz != 0 && timer_clock == TIMER_CLOCK_TSC)
+		return tsc_ns_base + timer_cycles_to_ns(rdtsc() - tsc_base);
+	return pit_ns();
+}
+
+/* Returns the number of nanoseconds elapsed since THEN, which
+   should be a value once returned by timer_ns(). */
+int64_t timer_elapsed_ns(int64_t then)
+{
+	return timer_ns() - then;
+}
+
+/* Converts CYCLES TSC cycles to nanoseconds.  Returns 0 before
+   timer_calibrate().  The product is split at bit 32 so that it
+   does not overflow for any realistic uptime. */
+uint64_t timer_cycles_to_ns(uint64_t cycles)
+{
+	return (((cycles >> 32) * tsc_mult) << (32 - TSC_SHIFT))
+		   + (((cycles & 0xffffffff) * tsc_mult) >> TSC_SHIFT);
+}
+
+/* Returns the measured TSC rate in Hz, or 0 before
+   timer_calibrate(). */
+uint64_t timer_tsc_hz(void)
+{
+	return tsc_hz;
+}
+
+/* Returns the kernel address of the clock page, to be mapped
+   read-only at VCLOCK_ADDR in user processes. */
+void *timer_vclock_page(void)
+{
+	return vclock;
+}
+
+/* timer_sleep() - 현재 스레드를 ticks만큼 BLOCKED 상태로 만든다.
+ * 깨어날 시각은 타이밍 휠에 등록된다.
  */
 void timer_sleep(int64_t ticks)
 {
@@ -119,28 +277,477 @@ void timer_nsleep(int64_t ns)
 void timer_print_stats(void)
 {
 	printf("Timer: %" PRId64 " ticks\n", timer_ticks());
+	printf("Timer: %'" PRId64 " ns since boot, %s clock, TSC at %'" PRIu64 " Hz\n",
+		   timer_ns(), timer_clock == TIMER_CLOCK_TSC ? "TSC" : "PIT", tsc_hz);
+	if (timer_tickless)
+		printf("Tickless: %" PRId64 " ticks without a timer interrupt\n", skipped_ticks);
+}
+
+/* timer_idle_enter - idle 스레드가 hlt 하기 직전에 인터럽트가 꺼진 상태로 호출한다.
+ * -tickless 모드에서는 주기적인 tick을 멈추고, 가장 먼저 만료되는 타이머(잠든 스레드)의 시각에
+ * 한 번만 인터럽트가 발생하도록 PIT를 one-shot 모드로 설정한다.
+ */
+void timer_idle_enter(void)
+{
+	int64_t delta;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	if (!timer_tickless || pit_oneshot || !list_empty(&hrsleepers))
+		return;
+
+	delta = timer_next_expiry() - os_ticks;
+	if (delta > PIT_MAX_TICKS)
+		delta = PIT_MAX_TICKS;
+	if (delta <= 1)
+		return;
+
+	pit_set_oneshot(delta * PIT_COUNT_PER_TICK - pit_residual);
+}
+
+/* timer_idle_exit - hlt에서 깨어난 idle 스레드가 인터럽트가 꺼진 상태로 호출한다.
+ * 타이머가 아닌 다른 인터럽트로 깨어났다면 PIT에서 지나간 시간을 읽어 그만큼의 tick을 따라잡고
+ * 다음 tick 경계(또는 더 이른 sub-tick 수면의 마감)에 맞춰 PIT를 다시 설정한다.
+ * os_ticks, 타이밍 휠, MLFQS 통계, idle_ticks가 모두 따라잡힌다.
+ */
+void timer_idle_exit(void)
+{
+	unsigned remaining, elapsed;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	if (!pit_oneshot)
+		return;
+
+	remaining = pit_read();
+	if (pit_irq_pending() || remaining == 0 || remaining > pit_oneshot_count)
+		/* The one-shot already expired and the counter wrapped.
+		   Its interrupt is still pending and accounts for the
+		   elapsed time itself. */
+		return;
+
+	elapsed = pit_oneshot_count - remaining + pit_residual;
+	pit_residual = elapsed % PIT_COUNT_PER_TICK;
+	for (elapsed /= PIT_COUNT_PER_TICK; elapsed > 0; elapsed--)
+	{
+		skipped_ticks++;
+		timer_do_tick();
+	}
+	pit_reprogram();
+}
+
+/* timer_next_expiry - 가장 먼저 처리해야 하는 타이밍 휠의 tick을 반환한다.
+ * 등록된 타이머가 없다면 INT64_MAX를 반환한다. 레벨 0에 타이머가 없다면
+ * 다음 cascade 시각을 반환하므로, 실제 만료 시각보다 이를 수는 있어도 늦지는 않다.
+ */
+int64_t timer_next_expiry(void)
+{
+	enum intr_level old_level = intr_disable();
+	int64_t next = INT64_MAX;
+	int64_t tick;
+
+	if (wheel_cnt != 0)
+	{
+		next = (wheel_ticks | WHEEL_MASK) + 1;
+		for (tick = wheel_ticks; tick < next; tick++)
+			if (!list_empty(&wheel[0][tick & WHEEL_MASK]))
+			{
+				next = tick;
+				break;
+			}
+	}
+	intr_set_level(old_level);
+	return next;
 }
 
 /* timer_interrupt() - 타이머 인터럽트 핸들러. 10ms당 한 번씩 호출. 1초에 100번 호출
  */
-static void timer_interrupt(struct intr_frame *args UNUSED)
+static void timer_interrupt(struct intr_frame *args)
+{
+	if (profile_enabled && profile_hz == 0)
+		profile_sample(args);
+	if (pit_oneshot)
+	{
+		/* One-shot programmed by timer_idle_enter() or
+		   pit_reprogram() expired.  Count the ticks it covered,
+		   which may be none for a sub-tick sleeper.  Every tick
+		   but the last one went without an interrupt. */
+		unsigned elapsed = pit_oneshot_count + pit_residual;
+		unsigned ticks = elapsed / PIT_COUNT_PER_TICK;
+
+		pit_residual = elapsed % PIT_COUNT_PER_TICK;
+		pit_oneshot_count = 0; /* Now accounted for, see pit_ns(). */
+		for (; ticks > 0; ticks--)
+		{
+			if (ticks > 1)
+				skipped_ticks++;
+			timer_do_tick();
+		}
+		hrsleep_run();
+		pit_reprogram();
+	}
+	else
+	{
+		timer_do_tick();
+		if (!list_empty(&hrsleepers))
+		{
+			hrsleep_run();
+			pit_reprogram();
+		}
+	}
+}
+
+/* timer_do_tick - 한 tick 동안 일어나야 하는 일을 처리한다.
+ * 타이머 인터럽트마다 한 번, tickless 모드에서는 건너뛴 tick마다 한 번씩 호출된다.
+ */
+static void timer_do_tick(void)
 {
 	os_ticks++;
+	vclock_publish();
 	thread_tick();
-	thread_wakeup(os_ticks);
+	wheel_run(os_ticks);
 
 	if (!thread_mlfqs)
 		return;
 
-	if (timer_ticks() % TIMER_FREQ == 0) {
+	/* recent_cpu와 priority는 실행 중인 스레드와 ready 큐의 스레드만 갱신한다.
+	   BLOCKED 스레드는 깨어날 때 밀린 만큼 한꺼번에 갱신된다. */
+	if (os_ticks % TIMER_FREQ == 0) {
 		calculate_load_avg();
 		calculate_all_recent_cpu();
 	}
-	if (timer_ticks() % 4 == 0)
+	if (os_ticks % 4 == 0)
 		calculate_all_priority();
 	recent_cpu_plus();
 }
 
+/* timer_add - 타이머 T를 EXPIRES tick에 FUNC(AUX)가 호출되도록 타이밍 휠에 등록한다.
+ * EXPIRES가 이미 지났다면 다음 tick에 호출된다. T는 이미 등록되어 있으면 안 된다.
+ * FUNC는 타이머 인터럽트 핸들러에서 인터럽트가 꺼진 상태로 호출되므로 잠들 수 없다.
+ */
+void timer_add(struct timer *t, int64_t expires, timer_func *func, void *aux)
+{
+	enum intr_level old_level;
+
+	ASSERT(t != NULL);
+	ASSERT(func != NULL);
+
+	old_level = intr_disable();
+	ASSERT(!t->pending);
+	t->expires = expires;
+	t->func = func;
+	t->aux = aux;
+	t->pending = true;
+	wheel_insert(t, false);
+	wheel_cnt++;
+	intr_set_level(old_level);
+}
+
+/* timer_cancel - 등록된 타이머 T를 취소한다. T가 아직 만료되지 않아 취소되었다면 true를 반환한다.
+ */
+bool timer_cancel(struct timer *t)
+{
+	enum intr_level old_level;
+	bool pending;
+
+	ASSERT(t != NULL);
+
+	old_level = intr_disable();
+	pending = t->pending;
+	if (pending)
+	{
+		list_remove(&t->elem);
+		t->pending = false;
+		wheel_cnt--;
+	}
+	intr_set_level(old_level);
+	return pending;
+}
+
+/* timer_pending - 타이머 T가 아직 만료되지 않았다면 true를 반환한다.
+ */
+bool timer_pending(const struct timer *t)
+{
+	return t->pending;
+}
+
+/* wheel_insert - 타이머 T를 만료 시각까지 남은 tick 수에 맞는 레벨의 슬롯에 넣는다.
+ * FRONT가 참이면 슬롯의 맨 앞에, 아니면 맨 뒤에 넣는다.
+ */
+static void wheel_insert(struct timer *t, bool front)
+{
+	int64_t expires = t->expires < wheel_ticks ? wheel_ticks : t->expires;
+	int64_t delta = expires - wheel_ticks;
+	struct list *slot;
+	int level;
+
+	for (level = 0; level < WHEEL_LEVELS; level++)
+		if (delta < (int64_t)1 << (WHEEL_BITS * (level + 1)))
+			break;
+
+	if (level == WHEEL_LEVELS)
+		slot = &wheel_overflow;
+	else
+		slot = &wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+
+	if (front)
+		list_push_front(slot, &t->elem);
+	else
+		list_push_back(slot, &t->elem);
+}
+
+/* wheel_reinsert - SLOT의 타이머를 모두 떼어내 남은 tick 수에 맞는 슬롯으로 다시 넣는다.
+ * 같은 만료 시각이라면 상위 레벨에서 내려오는 타이머가 아래 레벨에 직접 등록된 타이머보다
+ * 항상 먼저 등록된 것이므로, 뒤에서부터 꺼내 각 슬롯의 맨 앞에 넣으면
+ * 정렬 없이 O(1)로 등록 순서가 유지된다.
+ */
+static void wheel_reinsert(struct list *slot)
+{
+	struct list tmp;
+
+	list_init(&tmp);
+	if (!list_empty(slot))
+		list_splice(list_end(&tmp), list_begin(slot), list_end(slot));
+	while (!list_empty(&tmp))
+		wheel_insert(list_entry(list_pop_back(&tmp), struct timer, elem), true);
+}
+
+/* wheel_cascade - LEVEL 레벨의 IDX 슬롯에 있는 타이머를 모두 한 단계 아래 레벨로 옮기고 IDX를 반환한다.
+ */
+static int wheel_cascade(int level, int idx)
+{
+	wheel_reinsert(&wheel[level][idx]);
+	return idx;
+}
+
+/* wheel_run - NOW tick까지 만료된 타이머의 콜백을 호출한다.
+ * 등록된 타이머가 없다면 아무 일도 하지 않으므로, tick마다의 비용은 만료된 타이머 수에 비례한다.
+ */
+static void wheel_run(int64_t now)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	while (wheel_ticks <= now)
+	{
+		int idx = wheel_ticks & WHEEL_MASK;
+		struct list *slot;
+		struct list expired;
+
+		if (wheel_cnt == 0)
+		{
+			wheel_ticks = now + 1;
+			break;
+		}
+
+		if (idx == 0
+			&& wheel_cascade(1, (wheel_ticks >> WHEEL_BITS) & WHEEL_MASK) == 0
+			&& wheel_cascade(2, (wheel_ticks >> (2 * WHEEL_BITS)) & WHEEL_MASK) == 0
+			&& wheel_cascade(3, (wheel_ticks >> (3 * WHEEL_BITS)) & WHEEL_MASK) == 0)
+			wheel_reinsert(&wheel_overflow);
+
+		/* 콜백이 같은 타이머를 다시 등록해도 다음 tick으로 들어가도록
+		   슬롯을 떼어낸 뒤 wheel_ticks를 먼저 증가시킨다. */
+		slot = &wheel[0][idx];
+		list_init(&expired);
+		if (!list_empty(slot))
+			list_splice(list_end(&expired), list_begin(slot), list_end(slot));
+		wheel_ticks++;
+
+		while (!list_empty(&expired))
+		{
+			struct timer *t = list_entry(list_pop_front(&expired), struct timer, elem);
+			t->pending = false;
+			wheel_cnt--;
+			t->func(t->aux);
+		}
+	}
+}
+
+/* Programs counter 0 to interrupt TIMER_FREQ times per second. */
+static void pit_set_periodic(void)
+{
+	outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb(0x40, PIT_COUNT_PER_TICK & 0xff);
+	outb(0x40, PIT_COUNT_PER_TICK >> 8);
+	pit_oneshot = false;
+}
+
+/* Programs counter 0 to interrupt once, after COUNT PIT cycles. */
+static void pit_set_oneshot(unsigned count)
+{
+	ASSERT(count > 0 && count <= 0xffff);
+
+	outb(0x43, 0x30); /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb(0x40, count & 0xff);
+	outb(0x40, count >> 8);
+	pit_oneshot = true;
+	pit_oneshot_count = count;
+}
+
+/* Latches and returns the current value of counter 0. */
+static unsigned pit_read(void)
+{
+	unsigned count;
+
+	outb(0x43, 0x00);
+	count = inb(0x40);
+	count |= inb(0x40) << 8;
+	return count;
+}
+
+/* Returns true if the 8259A holds a timer interrupt that has not
+   been delivered yet.  See [8259A] for OCW3. */
+static bool pit_irq_pending(void)
+{
+	outb(0x20, 0x0a); /* OCW3: read IRR. */
+	return inb(0x20) & 0x01;
+}
+
+/* pit_sync - 인터럽트가 꺼진 스레드 문맥에서, counter 0을 다시 설정할 수 있도록
+ * 마지막으로 카운터를 설정한 뒤 흐른 PIT 사이클을 pit_residual에 더한다.
+ * 타이머 인터럽트가 이미 대기 중이라면 그 핸들러가 시간을 정산하고 PIT를 다시 설정하므로 false를 반환한다.
+ * tick을 세는 것은 핸들러의 몫이므로 pit_residual은 한 tick을 넘을 수 있다.
+ */
+static bool pit_sync(void)
+{
+	unsigned remaining = pit_read();
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	if (pit_irq_pending())
+		return false;
+	if (!pit_oneshot)
+		pit_residual += PIT_COUNT_PER_TICK - remaining;
+	else if (remaining == 0 || remaining > pit_oneshot_count)
+		return false;
+	else
+		pit_residual += pit_oneshot_count - remaining;
+	return true;
+}
+
+/* pit_reprogram - 다음 tick 경계와 가장 이른 sub-tick 수면의 마감 중 먼저 오는 시각에
+ * 인터럽트가 발생하도록 counter 0을 설정한다. 둘 다 한 tick 뒤라면 주기 모드로 돌아간다.
+ * pit_residual은 지금까지 정산된 위치여야 한다.
+ */
+static void pit_reprogram(void)
+{
+	int64_t count;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	if (pit_residual >= PIT_COUNT_PER_TICK)
+		count = PIT_MIN_COUNT; /* Overdue ticks, let the handler catch up. */
+	else
+		count = PIT_COUNT_PER_TICK - pit_residual;
+
+	if (!list_empty(&hrsleepers))
+	{
+		struct hrsleeper *s = list_entry(list_front(&hrsleepers), struct hrsleeper, elem);
+		int64_t delta = s->deadline - timer_ns();
+		int64_t until = delta <= 0 ? 0 : delta * PIT_HZ / 1000000000 + 1;
+
+		if (until < count)
+			count = until < PIT_MIN_COUNT ? PIT_MIN_COUNT : until;
+	}
+
+	if (count == PIT_COUNT_PER_TICK)
+		pit_set_periodic();
+	else
+		pit_set_oneshot(count);
+}
+
+/* Returns timer_ns() from the tick count and counter 0, for
+   use before the TSC is calibrated or with "-clock=pit".  Never
+   goes backward, even if a tick is pending. */
+static int64_t pit_ns(void)
+{
+	static int64_t last;
+	enum intr_level old_level = intr_disable();
+	unsigned remaining = pit_read();
+	unsigned position = pit_residual;
+	int64_t ns;
+
+	if (!pit_oneshot)
+		position += PIT_COUNT_PER_TICK - remaining;
+	else if (remaining == 0 || remaining > pit_oneshot_count)
+		position += pit_oneshot_count;
+	else
+		position += pit_oneshot_count - remaining;
+
+	ns = os_ticks * TIMER_NS_PER_TICK + (int64_t)position * 1000000000 / PIT_HZ;
+	if (ns < last)
+		ns = last;
+	last = ns;
+	intr_set_level(old_level);
+	return ns;
+}
+
+/* vclock_publish - tick 수와 TSC 보정값을 사용자 시계 페이지에 기록한다. 인터럽트가 꺼진 상태에서 호출해야 한다.
+ * 쓰는 동안 seq를 홀수로 만들어, 읽는 쪽은 seq가 짝수이고 읽기 전후로 같을 때까지 다시 읽는다.
+ * x86은 store끼리 순서를 바꾸지 않으므로 컴파일러 배리어만으로 충분하다.
+ */
+static void vclock_publish(void)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	vclock->seq++;
+	barrier();
+	vclock->tsc_shift = TSC_SHIFT;
+	vclock->ticks = os_ticks;
+	vclock->ns_per_tick = TIMER_NS_PER_TICK;
+	vclock->tsc_hz = tsc_hz;
+	vclock->tsc_base = tsc_base;
+	vclock->ns_base = tsc_ns_base;
+	vclock->tsc_mult = tsc_mult;
+	barrier();
+	vclock->seq++;
+}
+
+/* 마감 시각 기준 오름차순 삽입을 위한 비교 함수. */
+static bool hrsleeper_less(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
+{
+	return list_entry(a, struct hrsleeper, elem)->deadline < list_entry(b, struct hrsleeper, elem)->deadline;
+}
+
+/* hrsleep - 현재 스레드를 NS 나노초 동안 BLOCKED 상태로 만든다. NS는 한 tick보다 짧다.
+ * 가장 이른 마감이 되었다면 PIT를 one-shot으로 다시 설정하여 그 시각에 인터럽트가 발생하게 한다.
+ */
+static void hrsleep(int64_t ns)
+{
+	struct hrsleeper s;
+	enum intr_level old_level = intr_disable();
+
+	s.deadline = timer_ns() + ns;
+	s.thread = thread_current();
+	list_insert_ordered(&hrsleepers, &s.elem, hrsleeper_less, NULL);
+	if (list_front(&hrsleepers) == &s.elem && pit_sync())
+		pit_reprogram();
+	while (s.thread != NULL)
+		thread_block();
+	intr_set_level(old_level);
+}
+
+/* hrsleep_run - 타이머 인터럽트에서 마감이 지난 sub-tick 수면 스레드를 모두 깨운다.
+ * 깨어난 스레드가 실행 중인 스레드보다 우선순위가 높으면 인터럽트가 반환될 때 양보하여,
+ * 남은 time slice를 기다리지 않고 바로 실행되게 한다.
+ */
+static void hrsleep_run(void)
+{
+	int64_t now = timer_ns();
+	bool woken = false;
+
+	while (!list_empty(&hrsleepers))
+	{
+		struct hrsleeper *s = list_entry(list_front(&hrsleepers), struct hrsleeper, elem);
+		struct thread *t = s->thread;
+
+		if (s->deadline > now)
+			break;
+		list_pop_front(&hrsleepers);
+		s->thread = NULL;
+		thread_unblock(t);
+		woken = true;
+	}
+	if (woken)
+		thread_try_yield();
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool too_many_loops(unsigned loops)
@@ -193,10 +800,19 @@ static void real_time_sleep(int64_t num, int32_t denom)
 	}
 	else
 	{
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT(denom % 1000 == 0);
-		busy_wait(loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+		/* Otherwise, block until a one-shot timer interrupt for
+		   accurate sub-tick timing, or spin on the clock if the
+		   delay is too short to be worth a context switch. */
+		int64_t ns = num * (1000000000 / denom);
+
+		ASSERT(1000000000 % denom == 0);
+		if (ns >= SPIN_NS)
+			hrsleep(ns);
+		else
+		{
+			int64_t end = timer_ns() + ns;
+			while (timer_ns() < end)
+				barrier();
+		}
 	}
 }
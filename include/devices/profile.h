@@ -0,0 +1,21 @@
+#ifndef DEVICES_PROFILE_H
+#define DEVICES_PROFILE_H
+
+#include <stdbool.h>
+#include "threads/interrupt.h"
+
+/* Sampling profiler.
+
+   Enabled by kernel command-line option "-profile", which takes a
+   sample on every timer tick, or "-profile=HZ", which takes HZ
+   samples per second from the CMOS real-time clock instead, so
+   the rate does not depend on TIMER_FREQ.  HZ is rounded down to
+   a power of 2 between 2 and 8192. */
+extern bool profile_enabled;
+extern unsigned profile_hz;
+
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_print_stats (void);
+
+#endif /* devices/profile.h */
@@ -1,17 +1,35 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Nanoseconds per timer tick. */
+#define TIMER_NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+/* Clock source read by timer_ns().  Until timer_calibrate() has
+   measured the TSC rate, the PIT is used regardless. */
+enum timer_clock {
+	TIMER_CLOCK_TSC,            /* Time stamp counter (default). */
+	TIMER_CLOCK_PIT             /* Tick count plus 8254 counter 0. */
+};
+extern enum timer_clock timer_clock;
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_ns (void);
+int64_t timer_elapsed_ns (int64_t);
+uint64_t timer_cycles_to_ns (uint64_t cycles);
+uint64_t timer_tsc_hz (void);
+void *timer_vclock_page (void);
 
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
@@ -20,4 +38,28 @@ void timer_nsleep (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/* Tickless idle ("-tickless"). */
+extern bool timer_tickless;
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+int64_t timer_next_expiry (void);
+
+/* Kernel timer.  FUNC(AUX) is called once from the timer interrupt
+   handler, with interrupts off, on the first tick >= EXPIRES.
+   Timers are kept in a hierarchical timing wheel, so timer_add()
+   and timer_cancel() are O(1). */
+typedef void timer_func (void *aux);
+
+struct timer {
+	struct list_elem elem;      /* Element in a timing wheel slot. */
+	int64_t expires;            /* Tick on which FUNC is called. */
+	timer_func *func;           /* Callback. */
+	void *aux;                  /* Argument for FUNC. */
+	bool pending;               /* True while on the wheel. */
+};
+
+void timer_add (struct timer *, int64_t expires, timer_func *, void *aux);
+bool timer_cancel (struct timer *);
+bool timer_pending (const struct timer *);
+
 #endif /* devices/timer.h */
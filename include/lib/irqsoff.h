@@ -0,0 +1,30 @@
+#ifndef __LIB_IRQSOFF_H
+#define __LIB_IRQSOFF_H
+
+#include <stdint.h>
+
+/* Number of longest interrupts-off windows kept, one per call
+   site. */
+#define IRQSOFF_TOP 8
+
+/* Number of buckets in the window length histogram.  Bucket I
+   counts windows of [2**I, 2**(I+1)) TSC cycles; the last bucket
+   also counts everything longer. */
+#define IRQSOFF_BUCKETS 32
+
+/* One interrupts-off window. */
+struct irqsoff_window {
+	uint64_t cycles;                /* Length in TSC cycles. */
+	uint64_t site;                  /* Code that turned interrupts off. */
+};
+
+/* Interrupts-off latency statistics.  Shared between the kernel
+   and the irqsoff() system call. */
+struct irqsoff_stat {
+	uint64_t windows;               /* Windows measured. */
+	uint64_t total_cycles;          /* Sum of their lengths. */
+	struct irqsoff_window top[IRQSOFF_TOP]; /* Longest first. */
+	uint32_t hist[IRQSOFF_BUCKETS]; /* Window length histogram. */
+};
+
+#endif /* lib/irqsoff.h */
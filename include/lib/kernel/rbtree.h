@@ -0,0 +1,71 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+ *
+ * A balanced binary search tree: insertion and removal take
+ * O(log n) time, and the smallest element is cached so that
+ * rb_min() takes O(1) time.
+ *
+ * Like the list and hash table, the tree does not allocate
+ * memory.  Each structure that can be in a tree must embed a
+ * struct rb_elem member, and rb_entry() converts a struct
+ * rb_elem back into the structure that contains it.  See
+ * lib/kernel/list.h for a detailed explanation.
+ *
+ * Elements that compare equal are kept in insertion order: a new
+ * element is placed after the elements equal to it. */
+
+/*
+ * 레드-블랙 트리
+ * 균형 이진 탐색 트리로, 삽입과 삭제는 O(log n)이고 가장 작은 요소는 캐시되어 있어 rb_min()은 O(1)이다.
+ * 리스트, 해시 테이블과 마찬가지로 동적 할당을 하지 않으며, 트리에 들어갈 구조체는 struct rb_elem을 포함해야 한다.
+ * 같은 값의 요소들은 삽입된 순서를 유지한다.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rb_elem {
+	struct rb_elem *parent;     /* Parent, or NULL for the root. */
+	struct rb_elem *left;       /* Left child, or NULL. */
+	struct rb_elem *right;      /* Right child, or NULL. */
+	bool red;                   /* Node color. */
+};
+
+/* Converts pointer to tree element RB_ELEM into a pointer to
+   the structure that RB_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent     \
+		- offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+		const struct rb_elem *b,
+		void *aux);
+
+/* Red-black tree. */
+struct rbtree {
+	struct rb_elem *root;       /* Root, or NULL if empty. */
+	struct rb_elem *min;        /* Smallest element, or NULL if empty. */
+	size_t size;                /* Number of elements. */
+	rb_less_func *less;         /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void rb_init (struct rbtree *, rb_less_func *, void *aux);
+void rb_insert (struct rbtree *, struct rb_elem *);
+void rb_remove (struct rbtree *, struct rb_elem *);
+
+struct rb_elem *rb_min (const struct rbtree *);
+struct rb_elem *rb_next (struct rb_elem *);
+size_t rb_size (const struct rbtree *);
+bool rb_empty (const struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
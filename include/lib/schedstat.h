@@ -0,0 +1,27 @@
+#ifndef __LIB_SCHEDSTAT_H
+#define __LIB_SCHEDSTAT_H
+
+#include <stdint.h>
+
+/* Ready-to-run latency histogram.  Bucket I counts latencies of
+   [2**(I+SCHEDSTAT_SHIFT), 2**(I+SCHEDSTAT_SHIFT+1)) TSC cycles;
+   the first bucket also counts everything shorter and the last
+   everything longer.  A switch takes thousands of cycles, so
+   nothing useful is lost below 2**SCHEDSTAT_SHIFT, and the
+   histogram stays small enough to live in struct thread. */
+#define SCHEDSTAT_SHIFT 12
+#define SCHEDSTAT_BUCKETS 16
+
+/* Scheduler statistics of one thread, or of the whole system.
+   All times are in TSC cycles.  Shared between the kernel and
+   the schedstat() system call. */
+struct schedstat {
+	uint64_t ready_cycles;          /* Time spent on a run queue. */
+	uint64_t run_cycles;            /* Time spent running. */
+	uint64_t blocked_cycles;        /* Time spent blocked. */
+	uint64_t voluntary_switches;    /* Switches away because of blocking. */
+	uint64_t involuntary_switches;  /* Switches away because of preemption. */
+	uint32_t latency[SCHEDSTAT_BUCKETS]; /* Ready-to-run latency histogram. */
+};
+
+#endif /* lib/schedstat.h */
@@ -36,6 +36,10 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Instrumentation. */
+	SYS_SCHEDSTAT,              /* Read scheduler statistics. */
+	SYS_IRQSOFF,                /* Read or reset interrupts-off latency. */
 };
 
 #endif /* lib/syscall-nr.h */
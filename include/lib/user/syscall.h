@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <irqsoff.h>
+#include <schedstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -50,6 +52,10 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Instrumentation. */
+int schedstat (pid_t pid, struct schedstat *stat);
+int irqsoff (struct irqsoff_stat *stat, bool reset);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
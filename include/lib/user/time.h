@@ -0,0 +1,18 @@
+#ifndef __LIB_USER_TIME_H
+#define __LIB_USER_TIME_H
+
+#include <stdint.h>
+
+/* A point in time, as seconds and nanoseconds. */
+struct timespec {
+	int64_t tv_sec;
+	long tv_nsec;               /* 0...999,999,999. */
+};
+
+/* Clocks accepted by clock_gettime(). */
+#define CLOCK_MONOTONIC 1       /* Time since boot. */
+
+int clock_gettime (int clock_id, struct timespec *);
+int64_t clock_ns (void);
+
+#endif /* lib/user/time.h */
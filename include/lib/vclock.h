@@ -0,0 +1,31 @@
+#ifndef __LIB_VCLOCK_H
+#define __LIB_VCLOCK_H
+
+#include <stdint.h>
+
+/* User address of the clock page, the page just above the
+   user stack (USER_STACK).  The kernel maps it read-only into
+   every process when it loads, and the timer interrupt handler
+   keeps it current, so clock_gettime() in lib/user reads the
+   time without a system call. */
+#define VCLOCK_ADDR 0x47480000
+
+/* Contents of the clock page.  The kernel makes SEQ odd while it
+   writes the other members; a reader copies them between two
+   reads of an even, unchanged SEQ.
+
+   Nanoseconds since boot are NS_BASE plus the TSC cycles since
+   TSC_BASE converted as (CYCLES * TSC_MULT) >> TSC_SHIFT, or
+   TICKS * NS_PER_TICK while TSC_HZ is still 0. */
+struct vclock {
+	volatile uint32_t seq;          /* Update sequence number. */
+	uint32_t tsc_shift;
+	int64_t ticks;                  /* timer_ticks(). */
+	int64_t ns_per_tick;
+	uint64_t tsc_hz;                /* Measured TSC rate, 0 if unknown. */
+	uint64_t tsc_base;
+	int64_t ns_base;
+	uint64_t tsc_mult;
+};
+
+#endif /* lib/vclock.h */
@@ -1,6 +1,7 @@
 #ifndef THREADS_INTERRUPT_H
 #define THREADS_INTERRUPT_H
 
+#include <irqsoff.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -15,6 +16,12 @@ enum intr_level intr_set_level (enum intr_level);
 enum intr_level intr_enable (void);
 enum intr_level intr_disable (void);
 
+/* Interrupts-off latency tracer. */
+void intr_irqsoff_stop (void);
+void intr_irqsoff_get (struct irqsoff_stat *);
+void intr_irqsoff_reset (void);
+void intr_irqsoff_print (void);
+
 /* Interrupt stack frame. */
 struct gp_registers {
 	uint64_t r15;
@@ -0,0 +1,35 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Lock contention profiler.
+
+   Built only with `make LOCKSTAT=1', which defines LOCKSTAT.
+   Each struct lock and struct rwlock is then named after the
+   argument given to lock_init() or rwlock_init(), and every
+   acquisition is charged to a row keyed by that name and the
+   address the acquire function was called from.
+   Times are in TSC cycles.  Call sites are printed as addresses;
+   decode them with `backtrace kernel.o ADDR...'. */
+struct lockstat {
+	const char *name;           /* Lock name, NULL if row unused. */
+	void *site;                 /* Caller of lock_acquire(). */
+	uint64_t acquisitions;      /* Times acquired. */
+	uint64_t contentions;       /* Times the acquirer had to wait. */
+	uint64_t wait_total;        /* Cycles spent waiting. */
+	uint64_t wait_max;
+	uint64_t hold_total;        /* Cycles between acquire and release. */
+	uint64_t hold_max;
+};
+
+#ifdef LOCKSTAT
+struct lockstat *lockstat_acquired (const char *name, void *site,
+                                    uint64_t wait_start, uint64_t now,
+                                    bool contended);
+void lockstat_released (struct lockstat *, uint64_t acquired);
+void lockstat_print (void);
+#endif
+
+#endif /* threads/lockstat.h */
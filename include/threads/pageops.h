@@ -0,0 +1,47 @@
+#ifndef THREADS_PAGEOPS_H
+#define THREADS_PAGEOPS_H
+
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/vaddr.h"
+
+/* Whole-page operations.  Both arguments must be page-aligned
+   kernel virtual addresses, so every operation runs as a single
+   string instruction over PGSIZE / 8 words with no alignment
+   handling. */
+
+/* Copies the page at SRC to the page at DST. */
+static inline void
+copy_page (void *dst, const void *src) {
+	uint64_t cnt = PGSIZE / 8;
+
+	ASSERT (pg_ofs (dst) == 0 && pg_ofs (src) == 0);
+	asm volatile ("rep movsq"
+	              : "+D" (dst), "+S" (src), "+c" (cnt) : : "memory");
+}
+
+/* Fills the page at PAGE with zeros. */
+static inline void
+clear_page (void *page) {
+	uint64_t cnt = PGSIZE / 8;
+
+	ASSERT (pg_ofs (page) == 0);
+	asm volatile ("rep stosq"
+	              : "+D" (page), "+c" (cnt) : "a" (0) : "memory");
+}
+
+/* Returns true if the page at PAGE holds only zeros. */
+static inline bool
+page_is_zero (const void *page) {
+	uint64_t cnt = PGSIZE / 8;
+	bool zero;
+
+	ASSERT (pg_ofs (page) == 0);
+	asm volatile ("repe scasq"
+	              : "=@cce" (zero), "+D" (page), "+c" (cnt)
+	              : "a" (0) : "memory");
+	return zero;
+}
+
+#endif /* threads/pageops.h */
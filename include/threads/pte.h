@@ -41,5 +41,12 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=large page (PDEs and PDPEs only). */
+
+/* A PDE with PTE_PS maps a 2 MB large page directly, and a PDPE
+   with PTE_PS maps a 1 GB huge page, instead of pointing to the
+   next-level table. */
+#define LARGE_PGSIZE (1UL << PDXSHIFT)   /* Bytes mapped by a large PDE. */
+#define HUGE_PGSIZE (1UL << PDPESHIFT)   /* Bytes mapped by a huge PDPE. */
 
 #endif /* threads/pte.h */
@@ -0,0 +1,27 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.
+
+   A kmem_cache hands out objects of one fixed size, carved out
+   of page-sized slabs that hold nothing else, so an object costs
+   its own size rounded up to 8 bytes instead of the next power
+   of 2, and allocation does not contend with unrelated types on
+   a shared malloc() descriptor.
+
+   If a constructor is given, it runs once on every object when
+   its slab is created, not on every allocation: objects must be
+   given back with kmem_cache_free() in their constructed state. */
+
+/* Prepares a newly slabbed object. */
+typedef void kmem_ctor_func (void *obj);
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+                                      kmem_ctor_func *);
+void *kmem_cache_alloc (struct kmem_cache *) __attribute__ ((malloc));
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
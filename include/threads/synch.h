@@ -2,12 +2,51 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <rbtree.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/lockstat.h"
+
+struct thread;
+
+/* Priority-bucketed wait queue.
+   `levels' holds one leader per distinct waiting priority, highest
+   first, and bit P of `mask' is set while priority P has a leader.
+   Later waiters at the same priority queue up in FIFO order on
+   their leader's `peers'.  Leaders are also kept in a small hash
+   table keyed by queue and priority (synch.c), so finding the
+   leader to queue behind, or the next lower leader to insert
+   before, takes a bit scan and a hash lookup.  Inserting, picking
+   the next waiter and removing any waiter are all O(1). */
+struct waitq {
+	struct list levels;         /* Leaders, highest priority first. */
+	uint64_t mask;              /* Bit P set if priority P has a leader. */
+};
+
+/* A waiter in a waitq.  Each thread embeds one, since a thread
+   waits on at most one semaphore or condition variable at a time. */
+struct waitq_elem {
+	struct list_elem elem;      /* In `levels' or a leader's `peers'. */
+	struct list peers;          /* Leader only: same-priority waiters. */
+	struct waitq_elem *hash_next; /* Leader only: next in hash bucket. */
+	struct waitq *queue;        /* Queue waited on, or NULL. */
+	struct thread *thread;      /* Waiting thread. */
+	int priority;               /* Bucket this waiter sits in. */
+	bool leader;                /* True if in `levels'. */
+};
+
+void waitq_init (struct waitq *);
+bool waitq_empty (struct waitq *);
+int waitq_max_priority (struct waitq *);
+void waitq_push (struct waitq *, struct waitq_elem *, struct thread *);
+struct thread *waitq_pop (struct waitq *);
+void waitq_remove (struct waitq_elem *);
+void waitq_update (struct waitq_elem *);
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct waitq waiters;       /* Waiting threads. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -16,10 +55,23 @@ bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
  
+/* Priority donated through one held lock, or through one reader's
+   share of an rwlock.  Kept in the holder's `held_locks'. */
+struct lock_hold {
+	int donation;               /* Priority donated to the holder. */
+	struct rb_elem elem;        /* Element in holder's `held_locks'. */
+};
+
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct lock_hold hold;      /* Priority donation. */
+#ifdef LOCKSTAT
+	const char *name;           /* Name given to lock_init(). */
+	struct lockstat *stat;      /* Row charged for the current hold. */
+	uint64_t acquired;          /* TSC when the current hold began. */
+#endif
 };
 
 void lock_init (struct lock *);
@@ -27,17 +79,70 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+#ifdef LOCKSTAT
+/* Names each lock after the expression passed to lock_init(). */
+void lock_init_named (struct lock *, const char *name);
+#define lock_init(LOCK) lock_init_named (LOCK, #LOCK)
+#endif
+bool lock_higher_donation (const struct rb_elem *a, const struct rb_elem *b, void *aux);
+void donation_refresh (struct thread *);
+
+/* Reader-writer lock.  Writers are preferred: once a writer is
+   waiting, new readers wait behind it. */
+struct rwlock {
+	int readers;                /* Threads holding it shared. */
+	struct thread *writer;      /* Thread holding it exclusive, or NULL. */
+	struct waitq read_waiters;  /* Blocked readers. */
+	struct waitq write_waiters; /* Blocked writers. */
+	int writers_pending;        /* Writers waiting or woken but not
+	                               yet holding it. */
+
+	/* Priority donation. */
+	int donation;               /* Priority donated to every holder. */
+	struct lock_hold write_hold; /* Writer's entry in `held_locks'. */
+	struct list read_holds;     /* Readers' `struct rwlock_read's. */
+#ifdef LOCKSTAT
+	const char *name;           /* Name given to rwlock_init(). */
+	struct lockstat *write_stat; /* Row charged for the writer's hold. */
+	uint64_t write_acquired;    /* TSC when the writer's hold began. */
+#endif
+};
+
+/* One reader's share of an rwlock.  The reader provides it,
+   usually on its own stack, and passes the same one to
+   rwlock_read_acquire() and rwlock_read_release(). */
+struct rwlock_read {
+	struct rwlock *rwlock;      /* Lock held shared. */
+	struct thread *thread;      /* Reader. */
+	struct lock_hold hold;      /* Entry in reader's `held_locks'. */
+	struct list_elem elem;      /* Element in rwlock's `read_holds'. */
+#ifdef LOCKSTAT
+	struct lockstat *stat;      /* Row charged for this hold. */
+	uint64_t acquired;          /* TSC when this hold began. */
+#endif
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_read_acquire (struct rwlock *, struct rwlock_read *);
+void rwlock_read_release (struct rwlock *, struct rwlock_read *);
+void rwlock_write_acquire (struct rwlock *);
+void rwlock_write_release (struct rwlock *);
+bool rwlock_write_held_by_current_thread (const struct rwlock *);
+bool rwlock_read_held_by_current_thread (const struct rwlock *);
+#ifdef LOCKSTAT
+void rwlock_init_named (struct rwlock *, const char *name);
+#define rwlock_init(RW) rwlock_init_named (RW, #RW)
+#endif
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct waitq waiters;       /* Waiting threads. */
 };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
-bool cond_priority(const struct list_elem *a, const struct list_elem  *b, void *aux);
 
 /* Optimization barrier.
  *
@@ -3,9 +3,12 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
+#include <schedstat.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
 #include "include/threads/synch.h"
+#include "devices/timer.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -29,6 +32,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Nice values. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default nice value. */
+#define NICE_MAX 20                     /* Least nice to other threads. */
+
 /* Project 2: System Call FDT */
 #define FDT_PAGES 3
 #define FDT_SIZE (FDT_PAGES * (1<<9))
@@ -97,21 +105,36 @@ struct thread {
 	char name[16];                      /* Name (for debugging purposes). */
 	int priority;                       /* Priority. */
 	int64_t wakeup_ticks;                /* Time to wake up. */
+	struct timer sleep_timer;           /* Wakes the thread from thread_sleep(). */
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
 
 	/* For Priority Donation */
-	struct list donations; // 해당 스레드에게 기부를 해준 스레드
-	struct list_elem d_elem; // donations 리스트를 위한 list_elem
+	struct rbtree held_locks; // 보유한 잠금, 기부받는 우선순위가 높은 순
+	struct waitq_elem wait_elem; // 세마포어나 조건 변수의 waiters를 위한 원소
 	struct lock *wait_on_lock; // 기다리고 있는 잠금
+	struct rwlock *wait_on_rwlock; // 기다리고 있는 reader-writer 잠금
 	int original_priority; // 기부를 받기 전의 기존 우선순위
 
 	/* For MLFQS */
 	struct list_elem a_elem; // all_list를 위한 list_elem
 	int nice;
 	int recent_cpu;
+	int64_t mlfqs_epoch; // recent_cpu가 마지막으로 갱신된 시점(초)
+	bool background; // 참이면 priority가 PRI_MIN에 고정되고 load_avg에 세지 않는다. (thread_set_background())
+
+	/* For CFS */
+	struct rb_elem rb_elem; // 런큐의 cfs_tree를 위한 rb_elem
+	uint64_t vruntime; // 가중치를 적용한 누적 실행 시간(TSC)
+	uint64_t exec_start; // vruntime이 마지막으로 갱신된 시점(TSC)
 
+	/* For scheduler statistics */
+	struct schedstat stat;
+	uint64_t stat_since; // 현재 상태로 바뀐 시점(TSC)
+
+	/* Owned by threads/malloc.c. */
+	struct malloc_cache *malloc_cache;  /* Free block magazines. */
 
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
@@ -148,11 +171,17 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_print_schedstat (void);
+bool thread_get_schedstat (tid_t, struct schedstat *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -166,21 +195,22 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_try_yield (void);
+void thread_update_priority (struct thread *, int priority);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
+void thread_set_background (void);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
+int thread_nice_weight (int nice);
 
 void do_iret (struct intr_frame *tf);
 
 void thread_sleep(int64_t ticks);
-void thread_wakeup(int64_t ticks);
-bool less_wakeup_ticks(const struct list_elem *a, const struct list_elem *b, void *aux);
-bool higher_priority(const struct list_elem *a, const struct list_elem *b, void *aux);
 
 void calculate_load_avg(void);
 void calculate_all_recent_cpu(void);
@@ -0,0 +1,87 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Binary event trace.
+
+   Enabled with the `-trace[=TYPE,...]' kernel option.  Every
+   hooked event is appended to a fixed-size ring of struct
+   trace_event with interrupts off, so once the ring is full the
+   oldest events are overwritten.  At power off the ring is
+   dumped to the console unless the `trace-save FILE' action has
+   already written it to the file system.  utils/trace-decode
+   turns either form into a timeline. */
+
+/* Event types.  Each can be enabled separately. */
+enum trace_type {
+	TRACE_SCHED,                /* Switch.  ARG0=next tid, ARG1=old status. */
+	TRACE_FAULT,                /* Page fault.  ARG0=address.
+	                               Begin: ARG1=TRACE_FAULT_* flags.
+	                               End: ARG1=handled. */
+	TRACE_SWAP_IN,              /* ARG0=page va, ARG1=swap slot. */
+	TRACE_SWAP_OUT,             /* ARG0=page va, ARG1=swap slot. */
+	TRACE_DISK_READ,            /* ARG0=chan*2+dev, ARG1=sector. */
+	TRACE_DISK_WRITE,           /* ARG0=chan*2+dev, ARG1=sector. */
+	TRACE_SYSCALL,              /* ARG0=number.
+	                               Begin: ARG1=first argument.
+	                               End: ARG1=return value. */
+	TRACE_TYPE_CNT
+};
+
+/* Whether an event is a point in time or opens or closes an
+   interval on the thread that records it. */
+enum trace_phase {
+	TRACE_INSTANT,
+	TRACE_BEGIN,
+	TRACE_END
+};
+
+/* TRACE_FAULT begin flags. */
+#define TRACE_FAULT_USER 0x1
+#define TRACE_FAULT_WRITE 0x2
+#define TRACE_FAULT_NOT_PRESENT 0x4
+
+/* One event.  32 bytes, written to the trace file as is. */
+struct trace_event {
+	uint64_t tsc;               /* rdtsc() at the event. */
+	int32_t tid;                /* Thread that recorded it. */
+	uint8_t type;               /* enum trace_type. */
+	uint8_t phase;              /* enum trace_phase. */
+	uint16_t reserved;
+	uint64_t arg0;
+	uint64_t arg1;
+};
+
+/* Trace file header, followed by EVENT_CNT events, oldest
+   first. */
+#define TRACE_MAGIC 0x31454341525450ULL  /* "PTRACE1" */
+struct trace_header {
+	uint64_t magic;             /* TRACE_MAGIC. */
+	uint64_t event_cnt;         /* Events that follow. */
+	uint64_t lost_cnt;          /* Older events overwritten. */
+	uint64_t tsc_hz;            /* timer_tsc_hz(), 0 if unknown. */
+};
+
+/* Bit (1 << TYPE) is set for every enabled type. */
+extern unsigned trace_mask;
+
+bool trace_parse (const char *types);
+void trace_record (enum trace_type, enum trace_phase,
+                   uint64_t arg0, uint64_t arg1);
+void trace_dump (void);
+void trace_done (void);
+#ifdef FILESYS
+void trace_save (const char *file_name);
+#endif
+
+/* Records an event of TYPE if that type is enabled. */
+static inline void
+trace (enum trace_type type, enum trace_phase phase,
+       uint64_t arg0, uint64_t arg1) {
+	if (trace_mask & (1u << type))
+		trace_record (type, phase, arg0, arg1);
+}
+
+#endif /* threads/trace.h */
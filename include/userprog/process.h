@@ -18,4 +18,7 @@ struct lazy_load_arg {
 	uint32_t zero_bytes;
 };
 
+/* lazy_load_arg 전용 객체 캐시. vm_init()에서 만든다. */
+extern struct kmem_cache *lazy_load_arg_cache;
+
 #endif /* userprog/process.h */
@@ -2,6 +2,6 @@
 #define USERPROG_SYSCALL_H
 
 void syscall_init (void);
-struct lock filesys_lock;
+struct rwlock filesys_lock;
 
 #endif /* userprog/syscall.h */
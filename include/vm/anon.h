@@ -14,5 +14,6 @@ struct bitmap *swap_table;  // 0 - empty, 1 - filled
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_swap_copy (struct page *dst, struct page *src);
 
 #endif
@@ -62,6 +62,8 @@ struct page {
 
 	/* Your implementation */
 	struct hash_elem hash_elem;		/*Hash table element*/
+	struct list_elem map_elem;		/* frame->pages의 원소 */
+	uint64_t *pml4;			/* 이 페이지가 속한 주소 공간. 다른 프로세스가 프레임을 내보낼 때도 이것을 쓴다. */
  	bool writable;
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union 
@@ -87,6 +89,8 @@ struct frame {
 	void *kva;	//프레임의 커널 가상 주소를 가리키는 포인터 -> 페이지 프레임이 실제로 메모리에서 어디에 위치하는지
 	struct page *page; //프레임이 참조하는 페이지를 가리키는 포인터 -> 해당 프레임이 어떤 페이지를 가리키는지
 	struct list_elem frame_elem; //frame 구조체의 list_elem
+	struct list pages; //이 프레임을 매핑한 페이지들. page는 그중 첫 번째이며, 떠나면 다음 페이지가 이어받는다.
+	int ref_cnt; //이 프레임을 매핑한 페이지 수. fork 후 쓰기 시 복사(COW)로 공유하면 2 이상이 된다.
 };
 
 /* The function table for page operations.
@@ -118,6 +122,7 @@ struct page_operations {
  * 모든 설계는 여러분의 몫입니다. */
 struct supplemental_page_table {
 	struct hash hash_table;
+	void *huge_miss;	/* 2 MB 페이지로 매핑할 수 없다고 마지막으로 확인한 영역. */
 };
 
 #include "threads/thread.h"
@@ -131,6 +136,7 @@ bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
 void vm_init (void);
+void vm_print_stats (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -0,0 +1,302 @@
+/* Red-black tree.
+
+   The algorithms follow [CLRS] chapter 13, "Red-Black Trees",
+   with null pointers in place of the sentinel leaf.  See
+   rbtree.h for basic information. */
+
+#include "lib/kernel/rbtree.h"
+#include "../debug.h"
+
+static bool is_red (const struct rb_elem *);
+static void rotate_left (struct rbtree *, struct rb_elem *);
+static void rotate_right (struct rbtree *, struct rb_elem *);
+static void replace_child (struct rbtree *, struct rb_elem *old,
+		struct rb_elem *new);
+static void insert_fixup (struct rbtree *, struct rb_elem *);
+static void remove_fixup (struct rbtree *, struct rb_elem *,
+		struct rb_elem *parent);
+
+/* Initializes TREE as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rbtree *tree, rb_less_func *less, void *aux) {
+	ASSERT (tree != NULL);
+	ASSERT (less != NULL);
+
+	tree->root = NULL;
+	tree->min = NULL;
+	tree->size = 0;
+	tree->less = less;
+	tree->aux = aux;
+}
+
+/* Inserts E into TREE.  E is placed after any elements equal
+   to it. */
+void
+rb_insert (struct rbtree *tree, struct rb_elem *e) {
+	struct rb_elem **link = &tree->root;
+	struct rb_elem *parent = NULL;
+	bool is_min = true;
+
+	ASSERT (tree != NULL);
+	ASSERT (e != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		if (tree->less (e, parent, tree->aux))
+			link = &parent->left;
+		else {
+			link = &parent->right;
+			is_min = false;
+		}
+	}
+
+	e->parent = parent;
+	e->left = e->right = NULL;
+	e->red = true;
+	*link = e;
+	if (is_min)
+		tree->min = e;
+	tree->size++;
+
+	insert_fixup (tree, e);
+}
+
+/* Removes E from TREE.  E must be in TREE. */
+void
+rb_remove (struct rbtree *tree, struct rb_elem *e) {
+	struct rb_elem *child, *parent;
+	bool removed_red;
+
+	ASSERT (tree != NULL);
+	ASSERT (e != NULL);
+	ASSERT (tree->size > 0);
+
+	if (tree->min == e)
+		tree->min = rb_next (e);
+
+	if (e->left == NULL || e->right == NULL) {
+		/* E has at most one child, which takes its place. */
+		child = e->left != NULL ? e->left : e->right;
+		parent = e->parent;
+		removed_red = e->red;
+		replace_child (tree, e, child);
+	} else {
+		/* E's successor Y, which has no left child, takes E's
+		   place and color.  Y's right child takes Y's place. */
+		struct rb_elem *y = e->right;
+		while (y->left != NULL)
+			y = y->left;
+
+		child = y->right;
+		removed_red = y->red;
+		if (y->parent == e)
+			parent = y;
+		else {
+			parent = y->parent;
+			replace_child (tree, y, child);
+			y->right = e->right;
+			y->right->parent = y;
+		}
+		replace_child (tree, e, y);
+		y->left = e->left;
+		y->left->parent = y;
+		y->red = e->red;
+	}
+	tree->size--;
+
+	if (!removed_red)
+		remove_fixup (tree, child, parent);
+}
+
+/* Returns the smallest element in TREE, or a null pointer if
+   TREE is empty. */
+struct rb_elem *
+rb_min (const struct rbtree *tree) {
+	return tree->min;
+}
+
+/* Returns the element that follows E in TREE's order, or a null
+   pointer if E is the largest element. */
+struct rb_elem *
+rb_next (struct rb_elem *e) {
+	if (e->right != NULL) {
+		e = e->right;
+		while (e->left != NULL)
+			e = e->left;
+		return e;
+	}
+	while (e->parent != NULL && e == e->parent->right)
+		e = e->parent;
+	return e->parent;
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rb_size (const struct rbtree *tree) {
+	return tree->size;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rbtree *tree) {
+	return tree->root == NULL;
+}
+
+/* Returns true if E is a red node.  Null leaves are black. */
+static bool
+is_red (const struct rb_elem *e) {
+	return e != NULL && e->red;
+}
+
+/* Makes NEW take OLD's place as a child of OLD's parent, or as
+   the root of TREE.  NEW may be null. */
+static void
+replace_child (struct rbtree *tree, struct rb_elem *old,
+		struct rb_elem *new) {
+	if (old->parent == NULL)
+		tree->root = new;
+	else if (old == old->parent->left)
+		old->parent->left = new;
+	else
+		old->parent->right = new;
+	if (new != NULL)
+		new->parent = old->parent;
+}
+
+/* Rotates the subtree rooted at X to the left, so that X's
+   right child becomes its parent. */
+static void
+rotate_left (struct rbtree *tree, struct rb_elem *x) {
+	struct rb_elem *y = x->right;
+
+	x->right = y->left;
+	if (y->left != NULL)
+		y->left->parent = x;
+	replace_child (tree, x, y);
+	y->left = x;
+	x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, so that X's
+   left child becomes its parent. */
+static void
+rotate_right (struct rbtree *tree, struct rb_elem *x) {
+	struct rb_elem *y = x->left;
+
+	x->left = y->right;
+	if (y->right != NULL)
+		y->right->parent = x;
+	replace_child (tree, x, y);
+	y->right = x;
+	x->parent = y;
+}
+
+/* Restores the red-black properties after inserting red node E. */
+static void
+insert_fixup (struct rbtree *tree, struct rb_elem *e) {
+	struct rb_elem *parent;
+
+	while (is_red (parent = e->parent)) {
+		/* A red node is never the root, so PARENT has a parent. */
+		struct rb_elem *grandparent = parent->parent;
+
+		if (parent == grandparent->left) {
+			struct rb_elem *uncle = grandparent->right;
+			if (is_red (uncle)) {
+				parent->red = uncle->red = false;
+				grandparent->red = true;
+				e = grandparent;
+			} else {
+				if (e == parent->right) {
+					e = parent;
+					rotate_left (tree, e);
+					parent = e->parent;
+				}
+				parent->red = false;
+				grandparent->red = true;
+				rotate_right (tree, grandparent);
+			}
+		} else {
+			struct rb_elem *uncle = grandparent->left;
+			if (is_red (uncle)) {
+				parent->red = uncle->red = false;
+				grandparent->red = true;
+				e = grandparent;
+			} else {
+				if (e == parent->left) {
+					e = parent;
+					rotate_right (tree, e);
+					parent = e->parent;
+				}
+				parent->red = false;
+				grandparent->red = true;
+				rotate_left (tree, grandparent);
+			}
+		}
+	}
+	tree->root->red = false;
+}
+
+/* Restores the red-black properties after removing a black
+   node.  E, which may be null, is the node that took its place
+   and carries an extra black; PARENT is E's parent. */
+static void
+remove_fixup (struct rbtree *tree, struct rb_elem *e,
+		struct rb_elem *parent) {
+	while (e != tree->root && !is_red (e)) {
+		if (e == parent->left) {
+			struct rb_elem *sibling = parent->right;
+			if (is_red (sibling)) {
+				sibling->red = false;
+				parent->red = true;
+				rotate_left (tree, parent);
+				sibling = parent->right;
+			}
+			if (!is_red (sibling->left) && !is_red (sibling->right)) {
+				sibling->red = true;
+				e = parent;
+				parent = e->parent;
+			} else {
+				if (!is_red (sibling->right)) {
+					sibling->left->red = false;
+					sibling->red = true;
+					rotate_right (tree, sibling);
+					sibling = parent->right;
+				}
+				sibling->red = parent->red;
+				parent->red = false;
+				sibling->right->red = false;
+				rotate_left (tree, parent);
+				e = tree->root;
+			}
+		} else {
+			struct rb_elem *sibling = parent->left;
+			if (is_red (sibling)) {
+				sibling->red = false;
+				parent->red = true;
+				rotate_right (tree, parent);
+				sibling = parent->left;
+			}
+			if (!is_red (sibling->left) && !is_red (sibling->right)) {
+				sibling->red = true;
+				e = parent;
+				parent = e->parent;
+			} else {
+				if (!is_red (sibling->left)) {
+					sibling->right->red = false;
+					sibling->red = true;
+					rotate_left (tree, sibling);
+					sibling = parent->left;
+				}
+				sibling->red = parent->red;
+				parent->red = false;
+				sibling->left->red = false;
+				rotate_right (tree, parent);
+				e = tree->root;
+			}
+		}
+	}
+	if (e != NULL)
+		e->red = false;
+}
@@ -0,0 +1,55 @@
+#include <time.h>
+#include <stdint.h>
+#include <vclock.h>
+
+/* Reads the time from the clock page the kernel maps at
+   VCLOCK_ADDR, without a system call.  See lib/vclock.h. */
+
+static uint64_t
+read_tsc (void) {
+	uint32_t lo, hi;
+	__asm __volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+/* Returns the number of nanoseconds since the machine booted. */
+int64_t
+clock_ns (void) {
+	const struct vclock *vc = (const struct vclock *) VCLOCK_ADDR;
+	struct vclock snap;
+	uint64_t cycles;
+	uint32_t seq;
+
+	/* Copy the page while the kernel is not updating it. */
+	do {
+		seq = vc->seq;
+		__asm __volatile ("" : : : "memory");
+		snap = *vc;
+		cycles = read_tsc ();
+		__asm __volatile ("" : : : "memory");
+	} while ((seq & 1) != 0 || vc->seq != seq);
+
+	if (snap.tsc_hz == 0)
+		return snap.ticks * snap.ns_per_tick;
+
+	/* Same conversion as timer_cycles_to_ns() in the kernel. */
+	cycles -= snap.tsc_base;
+	return snap.ns_base
+	       + (int64_t) ((((cycles >> 32) * snap.tsc_mult) << (32 - snap.tsc_shift))
+	                    + (((cycles & 0xffffffff) * snap.tsc_mult) >> snap.tsc_shift));
+}
+
+/* Stores the current time of clock CLOCK_ID in *TS.  Returns 0
+   if successful, -1 if CLOCK_ID is not supported. */
+int
+clock_gettime (int clock_id, struct timespec *ts) {
+	int64_t ns;
+
+	if (clock_id != CLOCK_MONOTONIC)
+		return -1;
+
+	ns = clock_ns ();
+	ts->tv_sec = ns / 1000000000;
+	ts->tv_nsec = ns % 1000000000;
+	return 0;
+}
@@ -194,3 +194,13 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+schedstat (pid_t pid, struct schedstat *stat) {
+	return syscall2 (SYS_SCHEDSTAT, pid, stat);
+}
+
+int
+irqsoff (struct irqsoff_stat *stat, bool reset) {
+	return syscall2 (SYS_IRQSOFF, stat, reset);
+}
@@ -0,0 +1,85 @@
+/* Measures the cost of a context switch through the run queue
+   with 10, 100 and 1000 threads ready at the same time.
+
+   Every worker runs at the same priority and calls
+   thread_yield() in a loop, so each yield puts the current
+   thread back at the end of its ready queue and picks the next
+   one.  The total number of switches is kept the same for every
+   run, so the reported time per switch only grows if enqueueing
+   or picking the next thread depends on the number of ready
+   threads.
+
+   This is a benchmark, not a pass/fail test. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SWITCH_CNT 200000
+
+static thread_func yield_thread_func;
+
+struct ctxsw_data
+  {
+    int iterations;             /* Yields per worker. */
+    struct semaphore done;      /* Upped by each worker on exit. */
+  };
+
+static void
+run_ctxsw (int thread_cnt)
+{
+  struct ctxsw_data data;
+  int64_t start, elapsed;
+  int created, i;
+
+  data.iterations = SWITCH_CNT / thread_cnt;
+  sema_init (&data.done, 0);
+
+  /* Stay above the workers until they are all on the run queue. */
+  thread_set_priority (PRI_DEFAULT + 1);
+  for (created = 0; created < thread_cnt; created++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "%d", created);
+      if (thread_create (name, PRI_DEFAULT, yield_thread_func, &data)
+          == TID_ERROR)
+        break;
+    }
+
+  start = timer_ns ();
+  for (i = 0; i < created; i++)
+    sema_down (&data.done);
+  elapsed = timer_elapsed_ns (start);
+  thread_set_priority (PRI_DEFAULT);
+
+  if (created < thread_cnt)
+    msg ("only %d of %d threads could be created", created, thread_cnt);
+  msg ("%4d ready threads: %d switches in %lld us (%lld ns/switch)",
+       created, created * data.iterations, elapsed / 1000,
+       elapsed / (created * data.iterations > 0 ? created * data.iterations : 1));
+}
+
+void
+test_bench_ctxsw (void)
+{
+  /* This benchmark relies on strict priority round-robin. */
+  ASSERT (!thread_mlfqs);
+
+  run_ctxsw (10);
+  run_ctxsw (100);
+  run_ctxsw (1000);
+}
+
+static void
+yield_thread_func (void *data_)
+{
+  struct ctxsw_data *data = data_;
+  int i;
+
+  for (i = 0; i < data->iterations; i++)
+    thread_yield ();
+  sema_up (&data->done);
+}
@@ -0,0 +1,104 @@
+/* Measures how the CPU is shared between CPU-bound threads with
+   different nice values.
+
+   Four threads spin for BENCH_SECONDS seconds with nice values
+   -5, 0, 0 and 5.  Each one reports how many TSC cycles it ran
+   during that window, and the test prints its share of the total
+   next to the share its weight entitles it to.  Under -cfs the
+   two columns should agree closely; the other schedulers are
+   included for comparison.
+
+   This is a benchmark, not a pass/fail test. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define BENCH_SECONDS 10
+#define WORKER_CNT 4
+
+struct fair_data
+  {
+    int64_t deadline;           /* End of the window, in ticks. */
+    struct semaphore start;     /* Upped once per worker to start. */
+    struct semaphore done;      /* Upped by each worker when done. */
+  };
+
+struct fair_worker
+  {
+    struct fair_data *data;     /* Shared state. */
+    int nice;                   /* Nice value to run with. */
+    uint64_t run_cycles;        /* Cycles run during the window. */
+  };
+
+static thread_func spin_thread_func;
+
+void
+test_bench_fair (void)
+{
+  static const int nices[WORKER_CNT] = {-5, 0, 0, 5};
+  struct fair_data data;
+  struct fair_worker workers[WORKER_CNT];
+  uint64_t total_cycles = 0;
+  int total_weight = 0;
+  int i;
+
+  msg ("scheduler: %s",
+       thread_cfs ? "cfs" : thread_mlfqs ? "mlfqs" : "priority");
+
+  sema_init (&data.start, 0);
+  sema_init (&data.done, 0);
+  for (i = 0; i < WORKER_CNT; i++)
+    {
+      char name[16];
+      workers[i].data = &data;
+      workers[i].nice = nices[i];
+      snprintf (name, sizeof name, "nice %d", nices[i]);
+      thread_create (name, PRI_DEFAULT, spin_thread_func, &workers[i]);
+    }
+
+  data.deadline = timer_ticks () + BENCH_SECONDS * TIMER_FREQ;
+  for (i = 0; i < WORKER_CNT; i++)
+    sema_up (&data.start);
+  for (i = 0; i < WORKER_CNT; i++)
+    sema_down (&data.done);
+
+  for (i = 0; i < WORKER_CNT; i++)
+    {
+      total_cycles += workers[i].run_cycles;
+      total_weight += thread_nice_weight (workers[i].nice);
+    }
+  for (i = 0; i < WORKER_CNT; i++)
+    {
+      struct fair_worker *w = &workers[i];
+      int weight = thread_nice_weight (w->nice);
+      int share = total_cycles > 0 ? w->run_cycles * 1000 / total_cycles : 0;
+      int expected = weight * 1000 / total_weight;
+
+      msg ("nice %2d (weight %4d): %2d.%d%% of CPU, expected %2d.%d%%",
+           w->nice, weight, share / 10, share % 10,
+           expected / 10, expected % 10);
+    }
+}
+
+static void
+spin_thread_func (void *worker_)
+{
+  struct fair_worker *w = worker_;
+  struct fair_data *data = w->data;
+  struct schedstat start, end;
+
+  thread_set_nice (w->nice);
+  sema_down (&data->start);
+
+  thread_get_schedstat (thread_tid (), &start);
+  while (timer_ticks () < data->deadline)
+    continue;
+  thread_get_schedstat (thread_tid (), &end);
+
+  w->run_cycles = end.run_cycles - start.run_cycles;
+  sema_up (&data->done);
+}
@@ -0,0 +1,134 @@
+/* Measures malloc() and free() throughput with 1, 4 and 16
+   threads allocating at the same time.
+
+   Every worker keeps a working set of LIVE_CNT blocks of random
+   sizes between 16 and 512 bytes and repeatedly frees a random
+   one and allocates a new block in its place.  The workers run
+   at the same priority, so the timer preempts them in the middle
+   of their loops, including while one of them holds a malloc()
+   descriptor lock that the others then have to wait for.  The
+   total number of operations is kept the same for every run, so
+   the time per operation only grows with the number of threads
+   if the allocator serializes them.  The slowest single call is
+   reported too, since a call that blocks on a preempted lock
+   holder waits for at least a time slice.
+
+   This is a benchmark, not a pass/fail test. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define OP_CNT 400000
+#define LIVE_CNT 32
+
+static thread_func malloc_thread_func;
+
+struct malloc_data
+  {
+    int iterations;             /* Free/malloc pairs per worker. */
+    struct lock lock;           /* Protects SLOWEST. */
+    int64_t slowest;            /* Slowest call in ns. */
+    struct semaphore done;      /* Upped by each worker on exit. */
+  };
+
+static void
+run_malloc (int thread_cnt)
+{
+  struct malloc_data data;
+  int64_t start, elapsed;
+  int created, i, op_cnt;
+
+  data.iterations = OP_CNT / 2 / thread_cnt;
+  lock_init (&data.lock);
+  data.slowest = 0;
+  sema_init (&data.done, 0);
+
+  /* Stay above the workers until they are all on the run queue. */
+  thread_set_priority (PRI_DEFAULT + 1);
+  for (created = 0; created < thread_cnt; created++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "%d", created);
+      if (thread_create (name, PRI_DEFAULT, malloc_thread_func, &data)
+          == TID_ERROR)
+        break;
+    }
+
+  start = timer_ns ();
+  for (i = 0; i < created; i++)
+    sema_down (&data.done);
+  elapsed = timer_elapsed_ns (start);
+  thread_set_priority (PRI_DEFAULT);
+
+  if (created < thread_cnt)
+    msg ("only %d of %d threads could be created", created, thread_cnt);
+  op_cnt = created * data.iterations * 2;
+  msg ("%2d threads: %d operations in %lld us (%lld ns/op, slowest %lld ns)",
+       created, op_cnt, elapsed / 1000,
+       elapsed / (op_cnt > 0 ? op_cnt : 1), data.slowest);
+}
+
+void
+test_bench_malloc (void)
+{
+  /* This benchmark relies on strict priority round-robin. */
+  ASSERT (!thread_mlfqs);
+
+  random_init (0);
+  run_malloc (1);
+  run_malloc (4);
+  run_malloc (16);
+}
+
+/* Returns a random block size between 16 and 512 bytes. */
+static size_t
+random_size (void)
+{
+  return 16 << (random_ulong () % 6);
+}
+
+static void
+malloc_thread_func (void *data_)
+{
+  struct malloc_data *data = data_;
+  void *live[LIVE_CNT];
+  int64_t slowest = 0;
+  int i;
+
+  for (i = 0; i < LIVE_CNT; i++)
+    live[i] = malloc (random_size ());
+
+  for (i = 0; i < data->iterations; i++)
+    {
+      int slot = random_ulong () % LIVE_CNT;
+      size_t size = random_size ();
+      int64_t start, t;
+
+      start = timer_ns ();
+      free (live[slot]);
+      t = timer_elapsed_ns (start);
+      if (t > slowest)
+        slowest = t;
+
+      start = timer_ns ();
+      live[slot] = malloc (size);
+      t = timer_elapsed_ns (start);
+      if (t > slowest)
+        slowest = t;
+    }
+
+  for (i = 0; i < LIVE_CNT; i++)
+    free (live[i]);
+
+  lock_acquire (&data->lock);
+  if (slowest > data->slowest)
+    data->slowest = slowest;
+  lock_release (&data->lock);
+  sema_up (&data->done);
+}
@@ -0,0 +1,91 @@
+/* Measures the cost of palloc_get_multiple() and
+   palloc_free_multiple() on the user pool and how fragmented the
+   pool gets under a mixed workload.
+
+   Up to SLOT_CNT allocations are kept live at once.  Each step
+   either allocates into a random empty slot or frees a random
+   full one.  Three out of four allocations are single pages, the
+   rest between 2 and 32 pages, so multi-page requests have to
+   find room among scattered single pages.  After every phase the
+   number of free pages is compared with the largest block that a
+   single request could still get.
+
+   This is a benchmark, not a pass/fail test. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "devices/timer.h"
+
+#define SLOT_CNT 512
+#define STEP_CNT 200000
+
+struct slot
+  {
+    void *pages;                /* Null if the slot is empty. */
+    size_t page_cnt;
+  };
+
+static struct slot slots[SLOT_CNT];
+
+static void
+report (const char *phase)
+{
+  struct palloc_stats stats;
+
+  palloc_get_stats (PAL_USER, &stats);
+  msg ("%s: %zu pages free, largest block %zu pages", phase,
+       stats.free_cnt, stats.largest);
+}
+
+void
+test_bench_palloc (void)
+{
+  int64_t alloc_ns = 0, free_ns = 0, start;
+  int alloc_cnt = 0, free_cnt = 0, fail_cnt = 0;
+  int i;
+
+  random_init (0);
+  report ("before");
+
+  for (i = 0; i < STEP_CNT; i++)
+    {
+      struct slot *s = &slots[random_ulong () % SLOT_CNT];
+
+      if (s->pages == NULL)
+        {
+          s->page_cnt = random_ulong () % 4 ? 1 : 2 + random_ulong () % 31;
+          start = timer_ns ();
+          s->pages = palloc_get_multiple (PAL_USER, s->page_cnt);
+          alloc_ns += timer_elapsed_ns (start);
+          if (s->pages != NULL)
+            alloc_cnt++;
+          else
+            fail_cnt++;
+        }
+      else
+        {
+          start = timer_ns ();
+          palloc_free_multiple (s->pages, s->page_cnt);
+          free_ns += timer_elapsed_ns (start);
+          s->pages = NULL;
+          free_cnt++;
+        }
+    }
+  report ("mixed");
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].pages != NULL)
+      {
+        palloc_free_multiple (slots[i].pages, slots[i].page_cnt);
+        slots[i].pages = NULL;
+      }
+  report ("after");
+
+  msg ("%d allocations, %lld ns each; %d failed",
+       alloc_cnt, alloc_ns / (alloc_cnt + fail_cnt > 0 ? alloc_cnt + fail_cnt : 1),
+       fail_cnt);
+  msg ("%d frees, %lld ns each",
+       free_cnt, free_ns / (free_cnt > 0 ? free_cnt : 1));
+}
@@ -0,0 +1,67 @@
+/* Measures how fast threads can be created and torn down.
+
+   The main thread repeatedly creates a higher-priority worker
+   that exits at once, so every iteration pays for allocating
+   and initializing a thread page, one switch to the worker, its
+   exit, and the switch back.  This is the kernel-thread half of
+   a fork/exit cycle, without the address space copy.
+
+   Run it twice: the first run mostly allocates fresh pages, the
+   second one should be served from the cache of recycled thread
+   pages.
+
+   This is a benchmark, not a pass/fail test. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#endif
+
+#define SPAWN_CNT 5000
+
+static thread_func exit_thread_func;
+
+static void
+run_spawn (void)
+{
+  int64_t start, elapsed;
+  int i;
+
+  start = timer_ns ();
+  for (i = 0; i < SPAWN_CNT; i++)
+    {
+      tid_t tid = thread_create ("spawn", PRI_DEFAULT + 1,
+                                 exit_thread_func, NULL);
+      if (tid == TID_ERROR)
+        break;
+#ifdef USERPROG
+      /* Let the worker finish process_exit(). */
+      process_wait (tid);
+#endif
+    }
+  elapsed = timer_elapsed_ns (start);
+
+  if (i < SPAWN_CNT)
+    msg ("only %d of %d threads could be created", i, SPAWN_CNT);
+  msg ("%d threads created and exited in %lld us (%lld ns/thread)",
+       i, elapsed / 1000, elapsed / (i > 0 ? i : 1));
+}
+
+void
+test_bench_spawn (void)
+{
+  /* This benchmark relies on strict priority scheduling. */
+  ASSERT (!thread_mlfqs);
+
+  run_spawn ();
+  run_spawn ();
+}
+
+static void
+exit_thread_func (void *aux UNUSED)
+{
+}
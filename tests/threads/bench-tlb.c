@@ -0,0 +1,99 @@
+/* Measures the cost of kernel accesses to user frames through
+   the direct map, the way the VM code reaches them through
+   frame->kva.
+
+   Up to PAGE_CNT user-pool pages are allocated and one word of
+   each is read per pass, first in address order and then in a
+   random order, so with 4 kB mappings nearly every access needs
+   its own TLB entry.  Run once normally and once with
+   `-no-large-pages' to compare the 2 MB direct map against the
+   4 kB one; the first line shows how the direct map was built.
+
+   This is a benchmark, not a pass/fail test. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 8192
+#define PASS_CNT 20
+
+static volatile uint64_t sink;  /* Keeps the loads live. */
+
+/* Counts the 4 kB and 2 MB kernel mappings in base_pml4. */
+static bool
+count_mapping (uint64_t *pte, void *va, void *aux)
+{
+  size_t *cnt = aux;
+
+  if (is_kernel_vaddr (va))
+    cnt[is_large_pte (pte) ? 1 : 0]++;
+  return true;
+}
+
+/* Reads one word of each of the PAGE_CNT pages in PAGES, PASS_CNT
+   times, and reports the time per access. */
+static void
+touch (const char *order, uint64_t **pages, size_t page_cnt)
+{
+  int64_t start, elapsed;
+  uint64_t sum = 0;
+  size_t i;
+  int pass;
+
+  start = timer_ns ();
+  for (pass = 0; pass < PASS_CNT; pass++)
+    for (i = 0; i < page_cnt; i++)
+      sum += *pages[i];
+  elapsed = timer_elapsed_ns (start);
+  sink = sum;
+
+  msg ("%-10s %zu pages: %lld ns/access", order, page_cnt,
+       elapsed / (int64_t) (PASS_CNT * page_cnt));
+}
+
+void
+test_bench_tlb (void)
+{
+  uint64_t **pages;
+  size_t cnt[2] = {0, 0};
+  size_t page_cnt, i;
+
+  pml4_for_each (base_pml4, count_mapping, cnt);
+  msg ("direct map: %zu 4 kB pages, %zu 2 MB pages", cnt[0], cnt[1]);
+
+  pages = malloc (PAGE_CNT * sizeof *pages);
+  ASSERT (pages != NULL);
+  for (page_cnt = 0; page_cnt < PAGE_CNT; page_cnt++)
+    {
+      pages[page_cnt] = palloc_get_page (PAL_USER);
+      if (pages[page_cnt] == NULL)
+        break;
+      /* Vary the word within the page so that every access does
+         not map to the same cache set. */
+      pages[page_cnt] += page_cnt % (PGSIZE / sizeof (uint64_t));
+      *pages[page_cnt] = page_cnt;
+    }
+
+  touch ("sequential", pages, page_cnt);
+
+  /* Fisher-Yates shuffle. */
+  for (i = page_cnt; i > 1; i--)
+    {
+      size_t j = random_ulong () % i;
+      uint64_t *tmp = pages[i - 1];
+      pages[i - 1] = pages[j];
+      pages[j] = tmp;
+    }
+  touch ("random", pages, page_cnt);
+
+  for (i = 0; i < page_cnt; i++)
+    palloc_free_page (pg_round_down (pages[i]));
+  free (pages);
+}
@@ -0,0 +1,72 @@
+/* Two readers acquire an rwlock for reading and then block on a
+   semaphore while still holding it.  A higher-priority writer
+   then blocks on the rwlock, which should donate its priority to
+   both readers at once.  The readers release the rwlock one at a
+   time; the writer must not run until the last one has. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct rwlock_donate_data
+  {
+    struct rwlock rwlock;       /* Held for reading by both readers. */
+    struct semaphore go;        /* Readers wait here holding the rwlock. */
+    struct thread *readers[2];  /* The reader threads. */
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_priority_rwlock_donate (void) 
+{
+  struct rwlock_donate_data data;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&data.rwlock);
+  sema_init (&data.go, 0);
+  thread_create ("reader1", PRI_DEFAULT + 1, reader_thread_func, &data);
+  thread_create ("reader2", PRI_DEFAULT + 2, reader_thread_func, &data);
+  thread_create ("writer", PRI_DEFAULT + 5, writer_thread_func, &data);
+  for (i = 0; i < 2; i++)
+    msg ("reader%d should have priority %d.  Actual priority: %d.",
+         i + 1, PRI_DEFAULT + 5, data.readers[i]->priority);
+  for (i = 0; i < 2; i++)
+    sema_up (&data.go);
+  msg ("writer must already have finished.");
+}
+
+static void
+reader_thread_func (void *data_) 
+{
+  struct rwlock_donate_data *data = data_;
+  struct thread *t = thread_current ();
+  struct rwlock_read hold;
+
+  data->readers[t->name[6] - '1'] = t;
+  rwlock_read_acquire (&data->rwlock, &hold);
+  sema_down (&data->go);
+  msg ("%s: releasing with priority %d", t->name, thread_get_priority ());
+  rwlock_read_release (&data->rwlock, &hold);
+  msg ("%s: done", t->name);
+}
+
+static void
+writer_thread_func (void *data_) 
+{
+  struct rwlock_donate_data *data = data_;
+
+  rwlock_write_acquire (&data->rwlock);
+  msg ("writer: got the lock");
+  rwlock_write_release (&data->rwlock);
+  msg ("writer: done");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-rwlock-donate) begin
+(priority-rwlock-donate) reader1 should have priority 36.  Actual priority: 36.
+(priority-rwlock-donate) reader2 should have priority 36.  Actual priority: 36.
+(priority-rwlock-donate) reader1: releasing with priority 36
+(priority-rwlock-donate) reader1: done
+(priority-rwlock-donate) reader2: releasing with priority 36
+(priority-rwlock-donate) writer: got the lock
+(priority-rwlock-donate) writer: done
+(priority-rwlock-donate) reader2: done
+(priority-rwlock-donate) writer must already have finished.
+(priority-rwlock-donate) end
+EOF
+pass;
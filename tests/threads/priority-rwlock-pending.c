@@ -0,0 +1,76 @@
+/* A writer that has been woken to take an rwlock, but has not
+   run yet, must still keep new readers out.
+
+   A high-priority reader acquires the rwlock for reading and
+   blocks on a semaphore.  A lower-priority writer then blocks on
+   the rwlock.  When the reader is released, it drops the rwlock,
+   which wakes the writer, and tries to take it again at once.
+   Because the writer is still pending, the reader must wait for
+   it even though the writer has the lower priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct lock_and_sema
+  {
+    struct rwlock rwlock;
+    struct semaphore sema;
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_priority_rwlock_pending (void) 
+{
+  struct lock_and_sema ls;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&ls.rwlock);
+  sema_init (&ls.sema, 0);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &ls);
+  thread_create ("writer", PRI_DEFAULT - 1, writer_thread_func, &ls);
+
+  /* Let the writer block on the rwlock. */
+  thread_set_priority (PRI_DEFAULT - 2);
+  sema_up (&ls.sema);
+  msg ("reader, writer must already have finished.");
+  thread_set_priority (PRI_DEFAULT);
+}
+
+static void
+reader_thread_func (void *ls_) 
+{
+  struct lock_and_sema *ls = ls_;
+  struct rwlock_read hold;
+
+  rwlock_read_acquire (&ls->rwlock, &hold);
+  msg ("reader: got the lock");
+  sema_down (&ls->sema);
+  rwlock_read_release (&ls->rwlock, &hold);
+  msg ("reader: released the lock");
+  rwlock_read_acquire (&ls->rwlock, &hold);
+  msg ("reader: got the lock again");
+  rwlock_read_release (&ls->rwlock, &hold);
+  msg ("reader: done");
+}
+
+static void
+writer_thread_func (void *ls_) 
+{
+  struct lock_and_sema *ls = ls_;
+
+  msg ("writer: waiting for the lock");
+  rwlock_write_acquire (&ls->rwlock);
+  msg ("writer: got the lock");
+  rwlock_write_release (&ls->rwlock);
+  msg ("writer: done");
+}
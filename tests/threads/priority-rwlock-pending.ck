@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-rwlock-pending) begin
+(priority-rwlock-pending) reader: got the lock
+(priority-rwlock-pending) writer: waiting for the lock
+(priority-rwlock-pending) reader: released the lock
+(priority-rwlock-pending) writer: got the lock
+(priority-rwlock-pending) reader: got the lock again
+(priority-rwlock-pending) reader: done
+(priority-rwlock-pending) writer: done
+(priority-rwlock-pending) reader, writer must already have finished.
+(priority-rwlock-pending) end
+EOF
+pass;
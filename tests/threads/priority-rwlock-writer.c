@@ -0,0 +1,65 @@
+/* The main thread acquires an rwlock for reading.  Then it
+   creates a higher-priority writer that blocks on the rwlock and
+   donates its priority to the main thread.  A reader created
+   after that must wait behind the writer even though the lock is
+   only held for reading, and donates its own priority too.  When
+   the main thread releases the rwlock, the writer should run
+   first, with the waiting reader's priority, and the reader right
+   after it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+static thread_func reader_thread_func;
+
+void
+test_priority_rwlock_writer (void) 
+{
+  struct rwlock rwlock;
+  struct rwlock_read hold;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_read_acquire (&rwlock, &hold);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rwlock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  thread_create ("reader", PRI_DEFAULT + 2, reader_thread_func, &rwlock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  rwlock_read_release (&rwlock, &hold);
+  msg ("writer, reader must already have finished, in that order.");
+  msg ("This should be the last line before finishing this test.");
+}
+
+static void
+writer_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_write_acquire (rwlock);
+  msg ("writer: got the lock with priority %d", thread_get_priority ());
+  rwlock_write_release (rwlock);
+  msg ("writer: done");
+}
+
+static void
+reader_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+  struct rwlock_read hold;
+
+  rwlock_read_acquire (rwlock, &hold);
+  msg ("reader: got the lock");
+  rwlock_read_release (rwlock, &hold);
+  msg ("reader: done");
+}
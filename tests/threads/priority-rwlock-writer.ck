@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-rwlock-writer) begin
+(priority-rwlock-writer) This thread should have priority 32.  Actual priority: 32.
+(priority-rwlock-writer) This thread should have priority 33.  Actual priority: 33.
+(priority-rwlock-writer) writer: got the lock with priority 33
+(priority-rwlock-writer) reader: got the lock
+(priority-rwlock-writer) reader: done
+(priority-rwlock-writer) writer: done
+(priority-rwlock-writer) writer, reader must already have finished, in that order.
+(priority-rwlock-writer) This should be the last line before finishing this test.
+(priority-rwlock-writer) end
+EOF
+pass;
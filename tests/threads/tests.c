@@ -29,6 +29,10 @@ static const struct test tests[] =
         {"priority-preempt", test_priority_preempt},
         {"priority-sema", test_priority_sema},
         {"priority-condvar", test_priority_condvar},
+        {"priority-rwlock-writer", test_priority_rwlock_writer},
+        {"priority-rwlock-donate", test_priority_rwlock_donate},
+        {"priority-rwlock-pending", test_priority_rwlock_pending},
+        {"thread-reuse", test_thread_reuse},
         {"mlfqs-load-1", test_mlfqs_load_1},
         {"mlfqs-load-60", test_mlfqs_load_60},
         {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +42,13 @@ static const struct test tests[] =
         {"mlfqs-nice-2", test_mlfqs_nice_2},
         {"mlfqs-nice-10", test_mlfqs_nice_10},
         {"mlfqs-block", test_mlfqs_block},
+        {"bench-ctxsw", test_bench_ctxsw},
+        {"bench-spawn", test_bench_spawn},
+        {"bench-fair", test_bench_fair},
+        {"bench-palloc", test_bench_palloc},
+        {"bench-malloc", test_bench_malloc},
+        {"bench-mem", test_bench_mem},
+        {"bench-tlb", test_bench_tlb},
 };
 
 static const char *test_name;
@@ -23,6 +23,10 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_rwlock_writer;
+extern test_func test_priority_rwlock_donate;
+extern test_func test_priority_rwlock_pending;
+extern test_func test_thread_reuse;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +36,13 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_bench_ctxsw;
+extern test_func test_bench_spawn;
+extern test_func test_bench_fair;
+extern test_func test_bench_palloc;
+extern test_func test_bench_malloc;
+extern test_func test_bench_mem;
+extern test_func test_bench_tlb;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,58 @@
+/* Creates a higher-priority thread that exits at once, over and
+   over, while the main thread never blocks.  The reaper thread
+   runs at PRI_MIN, so it never gets to run, and only the
+   reclaim in thread_create() can return the dead threads' pages.
+   Each new thread should then be given the page of the one that
+   just exited, instead of a fresh page from palloc. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#endif
+
+#define THREAD_CNT 100
+
+static thread_func record_thread_func;
+
+void
+test_thread_reuse (void) 
+{
+  struct thread *first = NULL;
+  int reused = 0;
+  int i;
+
+  /* This test relies on strict priority scheduling. */
+  ASSERT (!thread_mlfqs);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct thread *t = NULL;
+      tid_t tid = thread_create ("reuse", PRI_DEFAULT + 1,
+                                 record_thread_func, &t);
+      if (tid == TID_ERROR)
+        fail ("thread_create() failed after %d threads", i);
+#ifdef USERPROG
+      /* Let the worker finish process_exit(). */
+      process_wait (tid);
+#endif
+      if (t == NULL)
+        fail ("higher-priority thread did not run");
+      if (i == 0)
+        first = t;
+      else if (t == first)
+        reused++;
+    }
+  msg ("%d of %d threads reused the first thread's page.",
+       reused, THREAD_CNT - 1);
+}
+
+static void
+record_thread_func (void *t_) 
+{
+  struct thread **t = t_;
+
+  *t = thread_current ();
+}
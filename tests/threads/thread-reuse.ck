@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-reuse) begin
+(thread-reuse) 99 of 99 threads reused the first thread's page.
+(thread-reuse) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Reads the clock page mapped by the kernel, checking that the
+   time never goes backward, that it advances while the process
+   runs, and that a forked child sees the same clock. */
+
+#include <syscall.h>
+#include <time.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* How long to watch the clock, in ns.  Several timer ticks. */
+#define WATCH_NS 50000000
+
+void
+test_main (void) 
+{
+  struct timespec ts;
+  int64_t start, prev, now;
+  int pid;
+
+  CHECK (clock_gettime (CLOCK_MONOTONIC, &ts) == 0, "clock_gettime");
+  CHECK (ts.tv_sec >= 0 && ts.tv_nsec >= 0 && ts.tv_nsec < 1000000000,
+         "timespec is normalized");
+  CHECK (clock_gettime (0, &ts) == -1, "unknown clock is rejected");
+
+  start = prev = clock_ns ();
+  do
+    {
+      now = clock_ns ();
+      if (now < prev)
+        fail ("clock went backward from %lld to %lld ns", prev, now);
+      prev = now;
+    }
+  while (now - start < WATCH_NS);
+  msg ("clock advanced");
+
+  if ((pid = fork ("child")))
+    {
+      int status = wait (pid);
+      msg ("Parent: child exit status is %d", status);
+    }
+  else
+    {
+      if (clock_ns () < now)
+        fail ("child clock is behind parent");
+      exit (81);
+    }
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-read) begin
+(clock-read) clock_gettime
+(clock-read) timespec is normalized
+(clock-read) unknown clock is rejected
+(clock-read) clock advanced
+child: exit(81)
+(clock-read) Parent: child exit status is 81
+(clock-read) end
+clock-read: exit(0)
+EOF
+pass;
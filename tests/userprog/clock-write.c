@@ -0,0 +1,14 @@
+/* This program attempts to write to the clock page, which the
+   kernel maps read-only.
+   This should terminate the process with a -1 exit code. */
+
+#include <vclock.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  ((struct vclock *) VCLOCK_ADDR)->ticks = 42;
+  fail ("should have exited with -1");
+}
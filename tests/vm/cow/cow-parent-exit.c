@@ -0,0 +1,68 @@
+/* Lets the process that owns a copy-on-write frame exit while its
+   child still shares it.  The main process forks a middle process,
+   which fills a page, forks a leaf and exits at once.  The leaf
+   must then be the frame's only user: its data is intact and its
+   write reuses the frame instead of copying it. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+/* Busy-waits until a file named NAME exists. */
+static void
+wait_for_file (const char *name)
+{
+	int fd;
+
+	while ((fd = open (name)) < 0)
+		continue;
+	close (fd);
+}
+
+static void
+leaf (void *pa)
+{
+	size_t i;
+
+	/* The middle process has exited and released its pages. */
+	wait_for_file ("gone");
+
+	for (i = 0; i < PAGE_SIZE; i++)
+		if (buf[i] != 'm')
+			fail ("byte %zu is %02hhx, should be 'm'", i, buf[i]);
+	msg ("data survives the parent's exit");
+	CHECK (get_phys_addr (buf) == pa, "leaf keeps the original frame");
+
+	buf[0] = 'l';
+	CHECK (get_phys_addr (buf) == pa, "leaf writes in place");
+	CHECK (create ("done", 0), "create \"done\"");
+
+	/* Exit without the "end" line, which could race with the main
+	   process shutting the machine down. */
+	exit (0);
+}
+
+void
+test_main (void)
+{
+	pid_t middle;
+	void *pa;
+
+	middle = fork ("middle");
+	if (middle == 0) {
+		memset (buf, 'm', PAGE_SIZE);
+		pa = get_phys_addr (buf);
+		if (fork ("leaf") == 0)
+			leaf (pa);
+		return;
+	}
+
+	wait (middle);
+	CHECK (create ("gone", 0), "create \"gone\"");
+	wait_for_file ("done");
+}
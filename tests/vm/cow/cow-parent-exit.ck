@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-parent-exit) begin
+(cow-parent-exit) end
+(cow-parent-exit) create "gone"
+(cow-parent-exit) data survives the parent's exit
+(cow-parent-exit) leaf keeps the original frame
+(cow-parent-exit) leaf writes in place
+(cow-parent-exit) create "done"
+(cow-parent-exit) end
+EOF
+pass;
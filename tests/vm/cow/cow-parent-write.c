@@ -0,0 +1,59 @@
+/* Writes to a copy-on-write page in the parent after fork.  The
+   parent must get a private copy, the child must keep seeing the
+   old data in the original frame, and once the parent has left
+   the frame the child's own write must reuse it in place. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+/* Returns true if the first SIZE bytes of P are all C. */
+static bool
+all_bytes (const char *p, size_t size, char c)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		if (p[i] != c)
+			return false;
+	return true;
+}
+
+void
+test_main (void)
+{
+	pid_t child;
+	void *pa;
+	int fd;
+
+	memset (buf, 'a', PAGE_SIZE);
+	pa = get_phys_addr (buf);
+
+	child = fork ("child");
+	if (child == 0) {
+		/* Wait until the parent has written. */
+		while ((fd = open ("written")) < 0)
+			continue;
+		close (fd);
+
+		CHECK (all_bytes (buf, PAGE_SIZE, 'a'), "child sees the data from before the write");
+		CHECK (get_phys_addr (buf) == pa, "child keeps the original frame");
+
+		buf[0] = 'c';
+		CHECK (get_phys_addr (buf) == pa, "child writes in place");
+		return;
+	}
+
+	buf[0] = 'p';
+	CHECK (get_phys_addr (buf) != pa, "parent's write takes a copy");
+	CHECK (create ("written", 0), "create \"written\"");
+	wait (child);
+
+	CHECK (buf[0] == 'p' && all_bytes (buf + 1, PAGE_SIZE - 1, 'a'),
+	       "parent sees its own data");
+}
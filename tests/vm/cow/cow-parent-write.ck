@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-parent-write) begin
+(cow-parent-write) parent's write takes a copy
+(cow-parent-write) create "written"
+(cow-parent-write) child sees the data from before the write
+(cow-parent-write) child keeps the original frame
+(cow-parent-write) child writes in place
+(cow-parent-write) end
+(cow-parent-write) parent sees its own data
+(cow-parent-write) end
+EOF
+pass;
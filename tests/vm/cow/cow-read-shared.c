@@ -0,0 +1,43 @@
+/* Reads a file into a buffer that fork left shared copy-on-write.
+   The kernel's write into the buffer must fault and give the child
+   a private copy, leaving the parent's data untouched. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+void
+test_main (void)
+{
+	size_t size = strlen (sample);
+	pid_t child;
+	void *pa;
+	size_t i;
+	int fd;
+
+	memset (buf, 'p', PAGE_SIZE);
+	pa = get_phys_addr (buf);
+
+	child = fork ("child");
+	if (child == 0) {
+		CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+		CHECK (read (fd, buf, size) == (int) size, "read \"sample.txt\"");
+		CHECK (memcmp (buf, sample, size) == 0, "child sees the file data");
+		CHECK (get_phys_addr (buf) != pa, "kernel write takes a copy");
+		close (fd);
+		return;
+	}
+	wait (child);
+
+	for (i = 0; i < PAGE_SIZE; i++)
+		if (buf[i] != 'p')
+			fail ("parent's byte %zu is %02hhx, should be 'p'", i, buf[i]);
+	msg ("parent's data is unchanged");
+	CHECK (get_phys_addr (buf) == pa, "parent keeps the original frame");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-read-shared) begin
+(cow-read-shared) open "sample.txt"
+(cow-read-shared) read "sample.txt"
+(cow-read-shared) child sees the file data
+(cow-read-shared) kernel write takes a copy
+(cow-read-shared) end
+(cow-read-shared) parent's data is unchanged
+(cow-read-shared) parent keeps the original frame
+(cow-read-shared) end
+EOF
+pass;
@@ -0,0 +1,71 @@
+/* Forks a process some of whose anonymous pages are on the swap
+   disk.  The parent writes more memory than fits in RAM, so its
+   earliest pages are swapped out, then maps, reads and unmaps a
+   file so that some frames are free again for the child.  The
+   child must see the parent's data in every page, including the
+   ones that were swapped out at fork time, and its own writes must
+   not show up in the parent. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (1 << PAGE_SHIFT)
+#define ONE_MB (1 << 20)
+#define CHUNK_SIZE (8 * ONE_MB)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static char big_chunks[CHUNK_SIZE];
+
+/* Fails unless every page of big_chunks starts with its index
+   plus DELTA. */
+static void
+check_pages (const char *who, char delta)
+{
+	size_t i;
+
+	for (i = 0; i < PAGE_COUNT; i++)
+		if (big_chunks[i * PAGE_SIZE] != (char) (i + delta))
+			fail ("%s: page %zu is inconsistent", who, i);
+	msg ("%s: data is consistent", who);
+}
+
+void
+test_main (void)
+{
+	char *actual = (char *) 0x10000000;
+	size_t size, i;
+	int handle;
+	void *map;
+	pid_t child;
+	volatile char c;
+
+	for (i = 0; i < PAGE_COUNT; i++)
+		big_chunks[i * PAGE_SIZE] = (char) i;
+	msg ("wrote %d pages", PAGE_COUNT);
+
+	/* Push more of the chunk out, then give the frames back. */
+	CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+	size = filesize (handle);
+	CHECK ((map = mmap (actual, size, 0, handle, 0)) != MAP_FAILED,
+	       "mmap \"large.txt\"");
+	for (i = 0; i < size; i += PAGE_SIZE)
+		c = actual[i];
+	munmap (map);
+	close (handle);
+	msg ("unmapped \"large.txt\"");
+
+	child = fork ("child");
+	if (child == 0) {
+		check_pages ("child", 0);
+		for (i = 0; i < PAGE_COUNT; i++)
+			big_chunks[i * PAGE_SIZE] = (char) (i + 1);
+		check_pages ("child", 1);
+		return;
+	}
+
+	wait (child);
+	check_pages ("parent", 0);
+}
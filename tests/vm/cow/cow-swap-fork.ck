@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-swap-fork) begin
+(cow-swap-fork) wrote 2048 pages
+(cow-swap-fork) open "large.txt"
+(cow-swap-fork) mmap "large.txt"
+(cow-swap-fork) unmapped "large.txt"
+(cow-swap-fork) child: data is consistent
+(cow-swap-fork) child: data is consistent
+(cow-swap-fork) end
+(cow-swap-fork) parent: data is consistent
+(cow-swap-fork) end
+EOF
+pass;
@@ -10,17 +10,21 @@
 #include <string.h>
 #include "devices/kbd.h"
 #include "devices/input.h"
+#include "devices/profile.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
+#include "threads/lockstat.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -49,6 +53,9 @@ static bool format_filesys;
 /* -q: Power off after kernel tasks complete? */
 bool power_off_when_done;
 
+/* -no-large-pages: Build the kernel direct map from 4 kB pages only? */
+static bool no_large_pages;
+
 bool thread_tests;
 
 static void bss_init(void);
@@ -57,6 +64,12 @@ static void paging_init(uint64_t mem_end);
 static char **read_command_line(void);
 static char **parse_options(char **argv);
 static void run_actions(char **argv);
+static void irqsoff_print(char **argv);
+static void irqsoff_reset(char **argv);
+static void trace_dump_action(char **argv);
+#ifdef FILESYS
+static void trace_save_action(char **argv);
+#endif
 static void usage(void);
 
 static void print_stats(void);
@@ -100,6 +113,7 @@ int main(void)
 	// PIC는 인터럽트 장치에 연결되어 CPU에 인터럽트를 전달하는 역할을 한다.
 	// idt는 인터럽트가 발생했을 때 어떤 인터럽트 핸들러를 호출할지를 결정하는 테이블이다.
 	timer_init(); 
+	profile_init();
 	kbd_init();
 	input_init();
 #ifdef USERPROG
@@ -108,6 +122,7 @@ int main(void)
 #endif
 	// 스레드 스케줄러 시작 및 인터럽트 활성화
 	thread_start(); // 가장 실행 우선 순위가 낮은 idle이라는 스레드를 생성하고 실행한다.
+	palloc_zero_init();
 	serial_init_queue();
 	timer_calibrate();
 
@@ -146,6 +161,10 @@ static void bss_init(void)
 /* Populates the page table with the kernel virtual mapping,
  * and then sets up the CPU to use the new page directory.
  * Points base_pml4 to the pml4 it creates. */
+/* paging_init - 커널 가상 매핑으로 페이지 테이블을 채우고 CPU가 새 페이지 디렉토리를 사용하도록 한다.
+ * 2 MB 단위로 정렬되어 통째로 mem_end 아래에 있는 영역은 큰 PDE 하나로 매핑해서
+ * 페이지 테이블 메모리와 TLB 엔트리를 아낀다. 첫 2 MB(ISA 홀이 섞인 영역)와
+ * 커널 코드가 걸친 영역은 코드만 읽기 전용으로 만들 수 있도록 4 kB PTE로 매핑한다. */
 static void paging_init(uint64_t mem_end)
 {
 	uint64_t *pml4, *pte;
@@ -153,18 +172,34 @@ static void paging_init(uint64_t mem_end)
 	pml4 = base_pml4 = palloc_get_page(PAL_ASSERT | PAL_ZERO);
 
 	extern char start, _end_kernel_text;
+	uint64_t text_start = vtop(&start);
+	uint64_t text_end = vtop(&_end_kernel_text);
+
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE)
+	for (uint64_t pa = 0; pa < mem_end;)
 	{
 		uint64_t va = (uint64_t)ptov(pa);
 
+		bool large = !no_large_pages && pa != 0 && pa % LARGE_PGSIZE == 0 && pa + LARGE_PGSIZE <= mem_end;
+		if (large && text_start < pa + LARGE_PGSIZE && pa < text_end)
+			large = false;
+
+		if (large)
+		{
+			if (!pml4_map_large(pml4, va, pa, PTE_W))
+				PANIC("out of memory for kernel page tables");
+			pa += LARGE_PGSIZE;
+			continue;
+		}
+
 		perm = PTE_P | PTE_W;
-		if ((uint64_t)&start <= va && va < (uint64_t)&_end_kernel_text)
+		if (text_start <= pa && pa < text_end)
 			perm &= ~PTE_W;
 
 		if ((pte = pml4e_walk(pml4, va, 1)) != NULL)
 			*pte = pa | perm;
+		pa += PGSIZE;
 	}
 
 	// reload cr3
@@ -227,6 +262,32 @@ static char **parse_options(char **argv)
 			random_init(atoi(value));
 		else if (!strcmp(name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp(name, "-cfs"))
+			thread_cfs = true;
+		else if (!strcmp(name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp(name, "-no-large-pages"))
+			no_large_pages = true;
+		else if (!strcmp(name, "-clock"))
+		{
+			if (value != NULL && !strcmp(value, "tsc"))
+				timer_clock = TIMER_CLOCK_TSC;
+			else if (value != NULL && !strcmp(value, "pit"))
+				timer_clock = TIMER_CLOCK_PIT;
+			else
+				PANIC("unknown clock source `%s' (use -h for help)", value != NULL ? value : "");
+		}
+		else if (!strcmp(name, "-profile"))
+		{
+			profile_enabled = true;
+			if (value != NULL)
+				profile_hz = atoi(value);
+		}
+		else if (!strcmp(name, "-trace"))
+		{
+			if (!trace_parse(value))
+				PANIC("unknown trace event type in `%s' (use -h for help)", value);
+		}
 #ifdef USERPROG
 		else if (!strcmp(name, "-ul"))
 			user_page_limit = atoi(value);
@@ -237,6 +298,9 @@ static char **parse_options(char **argv)
 			PANIC("unknown option `%s' (use -h for help)", name);
 	}
 
+	if (thread_mlfqs && thread_cfs)
+		PANIC("-mlfqs and -cfs cannot be used together");
+
 	return argv;
 }
 
@@ -261,6 +325,32 @@ static void run_task(char **argv)
 	printf("Execution of '%s' complete.\n", task);
 }
 
+/* 인터럽트가 꺼져 있던 가장 긴 구간들과 길이 분포를 출력한다. */
+static void irqsoff_print(char **argv UNUSED)
+{
+	intr_irqsoff_print();
+}
+
+/* 인터럽트가 꺼져 있던 구간의 통계를 비운다. */
+static void irqsoff_reset(char **argv UNUSED)
+{
+	intr_irqsoff_reset();
+}
+
+/* 트레이스 기록을 멈추고 링 버퍼를 콘솔로 출력한다. */
+static void trace_dump_action(char **argv UNUSED)
+{
+	trace_dump();
+}
+
+#ifdef FILESYS
+/* 트레이스 기록을 멈추고 링 버퍼를 파일 ARGV[1]에 저장한다. */
+static void trace_save_action(char **argv)
+{
+	trace_save(argv[1]);
+}
+#endif
+
 /* ARGV[]에 지정된 모든 액션을 널 포인터 센티널까지 실행한다.
  */
 static void run_actions(char **argv)
@@ -276,7 +366,11 @@ static void run_actions(char **argv)
 	/* Table of supported actions. */
 	static const struct action actions[] = {
 		{"run", 2, run_task},
+		{"irqsoff", 1, irqsoff_print},
+		{"irqsoff-reset", 1, irqsoff_reset},
+		{"trace-dump", 1, trace_dump_action},
 #ifdef FILESYS
+		{"trace-save", 2, trace_save_action},
 		{"ls", 1, fsutil_ls},
 		{"cat", 2, fsutil_cat},
 		{"rm", 2, fsutil_rm},
@@ -322,7 +416,11 @@ static void usage(void)
 #else
 		   "  run TEST           Run TEST.\n"
 #endif
+		   "  irqsoff            Print the longest interrupts-off windows.\n"
+		   "  irqsoff-reset      Clear interrupts-off statistics.\n"
+		   "  trace-dump         Stop tracing and print the trace.\n"
 #ifdef FILESYS
+		   "  trace-save FILE    Stop tracing and save the trace to FILE.\n"
 		   "  ls                 List files in the root directory.\n"
 		   "  cat FILE           Print FILE to the console.\n"
 		   "  rm FILE            Delete FILE.\n"
@@ -336,6 +434,13 @@ static void usage(void)
 		   "  -f                 Format file system disk during startup.\n"
 		   "  -rs=SEED           Set random number seed to SEED.\n"
 		   "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+		   "  -cfs               Use completely fair scheduler.\n"
+		   "  -tickless          Stop the periodic timer tick while idle.\n"
+		   "  -no-large-pages    Map kernel memory with 4 kB pages only.\n"
+		   "  -clock=tsc|pit     Read high-resolution time from TSC or PIT.\n"
+		   "  -profile[=HZ]      Sample kernel rip every tick, or HZ times/s.\n"
+		   "  -trace[=TYPE,...]  Trace sched,fault,swap-in,swap-out,disk-read,\n"
+		   "                     disk-write,syscall events (default all).\n"
 #ifdef USERPROG
 		   "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -351,6 +456,7 @@ void power_off(void)
 	filesys_done();
 #endif
 
+	trace_done();
 	print_stats();
 
 	printf("Powering off...\n");
@@ -364,6 +470,16 @@ static void print_stats(void)
 {
 	timer_print_stats();
 	thread_print_stats();
+	profile_print_stats();
+	thread_print_schedstat();
+	palloc_print_stats();
+	kmem_print_stats();
+#ifdef VM
+	vm_print_stats();
+#endif
+#ifdef LOCKSTAT
+	lockstat_print();
+#endif
 #ifdef FILESYS
 	disk_print_stats();
 #endif
@@ -3,6 +3,7 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
@@ -110,6 +111,18 @@ static void pic_end_of_interrupt (int irq);
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
 
+/* Interrupts-off latency tracer.  A window opens when interrupts
+   go from on to off and closes when they come back on.  Windows
+   that end without passing through intr_enable(), such as a new
+   thread starting with interrupts on, are dropped. */
+static struct irqsoff_stat irqsoff;
+static uint64_t irqsoff_start;  /* TSC when the window opened, 0 if none. */
+static void *irqsoff_site;      /* Code that opened it. */
+
+static enum intr_level intr_disable_at (void *site);
+static void irqsoff_begin (void *site);
+static void irqsoff_end (void);
+
 /* Returns the current interrupt status. */
 enum intr_level
 intr_get_level (void) {
@@ -131,7 +144,8 @@ intr_get_level (void) {
    returns the previous interrupt status. */
 enum intr_level
 intr_set_level (enum intr_level level) {
-	return level == INTR_ON ? intr_enable () : intr_disable ();
+	return (level == INTR_ON ? intr_enable ()
+	        : intr_disable_at (__builtin_return_address (0)));
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
@@ -140,6 +154,11 @@ intr_enable (void) {
 	enum intr_level old_level = intr_get_level ();
 	ASSERT (!intr_context ());
 
+	if (old_level == INTR_OFF)
+		irqsoff_end ();
+	else
+		irqsoff_start = 0;
+
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -152,6 +171,13 @@ intr_enable (void) {
 /* Disables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_disable (void) {
+	return intr_disable_at (__builtin_return_address (0));
+}
+
+/* Disables interrupts on behalf of the code at SITE and returns
+   the previous interrupt status. */
+static enum intr_level
+intr_disable_at (void *site) {
 	enum intr_level old_level = intr_get_level ();
 
 	/* Disable interrupts by clearing the interrupt flag.
@@ -159,9 +185,95 @@ intr_disable (void) {
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
 
+	if (old_level == INTR_ON)
+		irqsoff_begin (site);
 	return old_level;
 }
 
+/* Closes the current interrupts-off window.  For code that turns
+   interrupts on without intr_enable(), such as the idle loop's
+   `sti; hlt'.  Interrupts must be off. */
+void
+intr_irqsoff_stop (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	irqsoff_end ();
+}
+
+/* Copies the interrupts-off statistics into STAT. */
+void
+intr_irqsoff_get (struct irqsoff_stat *stat) {
+	enum intr_level old_level = intr_disable ();
+
+	*stat = irqsoff;
+	intr_set_level (old_level);
+}
+
+/* Clears the interrupts-off statistics. */
+void
+intr_irqsoff_reset (void) {
+	enum intr_level old_level = intr_disable ();
+
+	memset (&irqsoff, 0, sizeof irqsoff);
+	intr_set_level (old_level);
+}
+
+/* Prints the interrupts-off statistics.  Sites are code
+   addresses; decode them with `backtrace kernel.o ADDR...'. */
+void
+intr_irqsoff_print (void) {
+	struct irqsoff_stat stat;
+	int i;
+
+	intr_irqsoff_get (&stat);
+	printf ("Interrupts off: %llu windows, %llu cycles\n",
+	        stat.windows, stat.total_cycles);
+	for (i = 0; i < IRQSOFF_TOP && stat.top[i].cycles != 0; i++)
+		printf ("  %12llu cycles at %#llx\n", stat.top[i].cycles, stat.top[i].site);
+	printf ("Interrupts off: window length (cycles):\n");
+	for (i = 0; i < IRQSOFF_BUCKETS; i++)
+		if (stat.hist[i] != 0)
+			printf ("  2^%-2d %10u\n", i, stat.hist[i]);
+}
+
+/* Opens an interrupts-off window for the code at SITE. */
+static void
+irqsoff_begin (void *site) {
+	irqsoff_start = rdtsc ();
+	irqsoff_site = site;
+}
+
+/* Closes the open interrupts-off window, if any, and records it.
+   The top table keeps one entry per site, longest first. */
+static void
+irqsoff_end (void) {
+	uint64_t site = (uint64_t) irqsoff_site;
+	uint64_t cycles;
+	int bucket, i;
+
+	if (irqsoff_start == 0)
+		return;
+	cycles = rdtsc () - irqsoff_start;
+	irqsoff_start = 0;
+
+	irqsoff.windows++;
+	irqsoff.total_cycles += cycles;
+	bucket = cycles == 0 ? 0 : 63 - __builtin_clzll (cycles);
+	irqsoff.hist[bucket < IRQSOFF_BUCKETS ? bucket : IRQSOFF_BUCKETS - 1]++;
+
+	if (cycles <= irqsoff.top[IRQSOFF_TOP - 1].cycles)
+		return;
+	for (i = 0; i < IRQSOFF_TOP - 1; i++)
+		if (irqsoff.top[i].site == site)
+			break;
+	if (cycles <= irqsoff.top[i].cycles)
+		return;
+	for (; i > 0 && irqsoff.top[i - 1].cycles < cycles; i--)
+		irqsoff.top[i] = irqsoff.top[i - 1];
+	irqsoff.top[i].cycles = cycles;
+	irqsoff.top[i].site = site;
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init (void) {
@@ -341,6 +453,13 @@ intr_handler (struct intr_frame *frame) {
 	   and they need to be acknowledged on the PIC (see below).
 	   An external interrupt handler cannot sleep. */
 	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+
+	/* Entering through an interrupt gate turned interrupts off.
+	   Charge that window to the handler. */
+	handler = intr_handlers[frame->vec_no];
+	if (frame->eflags & FLAG_IF)
+		irqsoff_begin (handler != NULL ? (void *) handler : (void *) intr_handler);
+
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (!intr_context ());
@@ -350,7 +469,6 @@ intr_handler (struct intr_frame *frame) {
 	}
 
 	/* Invoke the interrupt's handler. */
-	handler = intr_handlers[frame->vec_no];
 	if (handler != NULL)
 		handler (frame);
 	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
@@ -375,6 +493,10 @@ intr_handler (struct intr_frame *frame) {
 		if (yield_on_return)
 			thread_yield ();
 	}
+
+	/* Returning will turn interrupts back on. */
+	if (frame->eflags & FLAG_IF && intr_get_level () == INTR_OFF)
+		irqsoff_end ();
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
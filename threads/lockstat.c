@@ -0,0 +1,124 @@
+#include "threads/lockstat.h"
+#ifdef LOCKSTAT
+#include <debug.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "threads/interrupt.h"
+#include "intrinsic.h"
+
+/* Number of rows.  Must be a power of 2.  Rows are never freed,
+   so once the table fills up further (name, site) pairs are all
+   charged to `lockstat_overflow'. */
+#define LOCKSTAT_SLOTS 512
+
+static struct lockstat lockstats[LOCKSTAT_SLOTS];
+static struct lockstat lockstat_overflow = { "(table full)", NULL, 0, 0, 0, 0, 0, 0 };
+static size_t lockstat_used;
+
+static struct lockstat *lockstat_lookup (const char *name, void *site);
+static int lockstat_more_contended (const void *, const void *, void *aux);
+
+/* Records that lock NAME was acquired at time NOW from SITE
+   after trying since WAIT_START, having had to wait if
+   CONTENDED.  Returns the row to pass to lockstat_released().
+   Must be called with interrupts off. */
+struct lockstat *
+lockstat_acquired (const char *name, void *site, uint64_t wait_start,
+                   uint64_t now, bool contended) {
+	struct lockstat *ls = lockstat_lookup (name, site);
+
+	ls->acquisitions++;
+	if (contended) {
+		uint64_t wait = now - wait_start;
+
+		ls->contentions++;
+		ls->wait_total += wait;
+		if (wait > ls->wait_max)
+			ls->wait_max = wait;
+	}
+	return ls;
+}
+
+/* Charges a hold that began at time ACQUIRED to row LS.  Must be
+   called with interrupts off. */
+void
+lockstat_released (struct lockstat *ls, uint64_t acquired) {
+	uint64_t hold = rdtsc () - acquired;
+
+	ls->hold_total += hold;
+	if (hold > ls->hold_max)
+		ls->hold_max = hold;
+}
+
+/* Returns the row for lock NAME acquired from SITE, creating it
+   if needed. */
+static struct lockstat *
+lockstat_lookup (const char *name, void *site) {
+	uintptr_t hash = ((uintptr_t) name ^ (uintptr_t) site) * 0x9e3779b97f4a7c15ULL;
+	size_t i, idx;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	idx = (hash >> 32) & (LOCKSTAT_SLOTS - 1);
+	for (i = 0; i < LOCKSTAT_SLOTS; i++) {
+		struct lockstat *ls = &lockstats[(idx + i) & (LOCKSTAT_SLOTS - 1)];
+
+		if (ls->name == name && ls->site == site)
+			return ls;
+		if (ls->name == NULL) {
+			if (lockstat_used >= LOCKSTAT_SLOTS * 3 / 4)
+				break;
+			lockstat_used++;
+			ls->name = name;
+			ls->site = site;
+			return ls;
+		}
+	}
+	return &lockstat_overflow;
+}
+
+/* Prints every row, most contended first. */
+void
+lockstat_print (void) {
+	static struct lockstat *rows[LOCKSTAT_SLOTS + 1];
+	enum intr_level old_level;
+	size_t cnt = 0;
+	size_t i;
+
+	old_level = intr_disable ();
+	for (i = 0; i < LOCKSTAT_SLOTS; i++)
+		if (lockstats[i].name != NULL)
+			rows[cnt++] = &lockstats[i];
+	if (lockstat_overflow.acquisitions != 0)
+		rows[cnt++] = &lockstat_overflow;
+	intr_set_level (old_level);
+
+	sort (rows, cnt, sizeof *rows, lockstat_more_contended, NULL);
+
+	printf ("Lockstat: %zu lock/call site pairs (cycles)\n", cnt);
+	printf ("  %-24s %-18s %10s %10s %14s %12s %14s %12s\n", "name", "site",
+	        "acquired", "contended", "wait-total", "wait-max", "hold-total", "hold-max");
+	for (i = 0; i < cnt; i++) {
+		struct lockstat *ls = rows[i];
+		const char *name = ls->name[0] == '&' ? ls->name + 1 : ls->name;
+
+		printf ("  %-24s %-18p %10llu %10llu %14llu %12llu %14llu %12llu\n", name, ls->site,
+		        ls->acquisitions, ls->contentions, ls->wait_total, ls->wait_max,
+		        ls->hold_total, ls->hold_max);
+	}
+}
+
+/* Orders rows by contended acquisitions, then by total wait,
+   both descending. */
+static int
+lockstat_more_contended (const void *a_, const void *b_, void *aux UNUSED) {
+	const struct lockstat *a = *(struct lockstat *const *) a_;
+	const struct lockstat *b = *(struct lockstat *const *) b_;
+
+	if (a->contentions != b->contentions)
+		return a->contentions > b->contentions ? -1 : 1;
+	if (a->wait_total != b->wait_total)
+		return a->wait_total > b->wait_total ? -1 : 1;
+	return 0;
+}
+#endif /* LOCKSTAT */
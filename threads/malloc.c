@@ -7,6 +7,7 @@
 #include <string.h>
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
@@ -32,7 +33,19 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Each thread also keeps a "magazine" of free blocks for every
+   descriptor, so that most requests are served without taking
+   the descriptor's lock, which would serialize unrelated threads
+   and drag them into priority donation.  An empty magazine is
+   refilled with a batch of blocks from the descriptor's free
+   list, and a full one gives a batch of its oldest blocks back,
+   all under a single lock acquisition.  Blocks in a magazine
+   still count as in use by their arena, so an arena only goes
+   back to the page allocator once its blocks have been flushed
+   there.  A thread's magazines are allocated on its first
+   malloc() and flushed by malloc_thread_exit(). */
 
 /* Descriptor. */
 struct desc {
@@ -61,8 +74,33 @@ struct block {
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Number of descriptors: 16, 32, ..., 1024 bytes. */
+#define MAG_DESC_CNT 7
+
+/* Blocks held by a magazine, and blocks moved at once between a
+   magazine and its descriptor.  A thread's set of magazines fits
+   in a 1 kB block. */
+#define MAG_SIZE 15
+#define MAG_BATCH 8
+
+/* Per-thread cache of free blocks of one descriptor. */
+struct magazine {
+	size_t cnt;                 /* Number of blocks held. */
+	struct block *blocks[MAG_SIZE]; /* Oldest first. */
+};
+
+/* A thread's magazines, one per descriptor. */
+struct malloc_cache {
+	struct magazine mags[MAG_DESC_CNT];
+};
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *desc_alloc (struct desc *);
+static void desc_free (struct desc *, struct block *);
+static struct malloc_cache *cache_get (void);
+static void mag_refill (struct desc *, struct magazine *);
+static void mag_flush (struct desc *, struct magazine *, size_t cnt);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -77,6 +115,7 @@ malloc_init (void) {
 		list_init (&d->free_list);
 		lock_init (&d->lock);
 	}
+	ASSERT (desc_cnt == MAG_DESC_CNT);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -84,8 +123,8 @@ malloc_init (void) {
 void *
 malloc (size_t size) {
 	struct desc *d;
-	struct block *b;
 	struct arena *a;
+	struct malloc_cache *c;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
@@ -112,35 +151,17 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
-
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
-
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
-			return NULL;
-		}
+	/* Take a block from this thread's magazine, refilling it
+	   from the descriptor if it is empty. */
+	c = cache_get ();
+	if (c != NULL) {
+		struct magazine *m = &c->mags[d - descs];
 
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
-		}
+		if (m->cnt == 0)
+			mag_refill (d, m);
+		return m->cnt > 0 ? m->blocks[--m->cnt] : NULL;
 	}
-
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
-	lock_release (&d->lock);
-	return b;
+	return desc_alloc (d);
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -204,6 +225,7 @@ free (void *p) {
 		struct block *b = p;
 		struct arena *a = block_to_arena (b);
 		struct desc *d = a->desc;
+		struct malloc_cache *c;
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
@@ -213,24 +235,17 @@ free (void *p) {
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
-			}
-
-			lock_release (&d->lock);
+			/* Put it in this thread's magazine, making room first if
+			   the magazine is full. */
+			c = thread_current ()->malloc_cache;
+			if (c != NULL) {
+				struct magazine *m = &c->mags[d - descs];
+
+				if (m->cnt == MAG_SIZE)
+					mag_flush (d, m, MAG_BATCH);
+				m->blocks[m->cnt++] = b;
+			} else
+				desc_free (d, b);
 		} else {
 			/* It's a big block.  Free its pages. */
 			palloc_free_multiple (a, a->free_cnt);
@@ -239,6 +254,156 @@ free (void *p) {
 	}
 }
 
+/* Flushes the running thread's magazines back to their
+   descriptors and frees them.  Called by thread_exit() after the
+   thread's last call to free(). */
+void
+malloc_thread_exit (void) {
+	struct thread *t = thread_current ();
+	struct malloc_cache *c = t->malloc_cache;
+	size_t i;
+
+	if (c == NULL)
+		return;
+	t->malloc_cache = NULL;
+	for (i = 0; i < desc_cnt; i++)
+		mag_flush (&descs[i], &c->mags[i], c->mags[i].cnt);
+	free (c);
+}
+
+/* Returns the running thread's magazines, allocating them on
+   first use.  Returns a null pointer if memory is not
+   available. */
+static struct malloc_cache *
+cache_get (void) {
+	struct thread *t = thread_current ();
+	struct desc *d;
+
+	if (t->malloc_cache == NULL) {
+		/* Allocate with the descriptor's lock, bypassing the
+		   magazines that do not exist yet. */
+		for (d = descs; d < descs + desc_cnt; d++)
+			if (d->block_size >= sizeof (struct malloc_cache))
+				break;
+		ASSERT (d < descs + desc_cnt);
+		t->malloc_cache = (struct malloc_cache *) desc_alloc (d);
+		if (t->malloc_cache != NULL)
+			memset (t->malloc_cache, 0, sizeof (struct malloc_cache));
+	}
+	return t->malloc_cache;
+}
+
+/* Takes a block from descriptor D's free list, creating a new
+   arena if it is empty.  Must be called with D's lock held.
+   Returns a null pointer if memory is not available. */
+static struct block *
+desc_take (struct desc *d) {
+	struct block *b;
+	struct arena *a;
+
+	/* If the free list is empty, create a new arena. */
+	if (list_empty (&d->free_list)) {
+		size_t i;
+
+		/* Allocate a page. */
+		a = palloc_get_page (0);
+		if (a == NULL)
+			return NULL;
+
+		/* Initialize arena and add its blocks to the free list. */
+		a->magic = ARENA_MAGIC;
+		a->desc = d;
+		a->free_cnt = d->blocks_per_arena;
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_push_back (&d->free_list, &b->free_elem);
+		}
+	}
+
+	/* Get a block from free list and return it. */
+	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+	a = block_to_arena (b);
+	a->free_cnt--;
+	return b;
+}
+
+/* Gives block B back to descriptor D's free list, and frees its
+   arena if it is now entirely unused.  Must be called with D's
+   lock held. */
+static void
+desc_put (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	/* Add block to free list. */
+	list_push_front (&d->free_list, &b->free_elem);
+
+	/* If the arena is now entirely unused, free it. */
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+		palloc_free_page (a);
+	}
+}
+
+/* Obtains a block from descriptor D under its lock. */
+static struct block *
+desc_alloc (struct desc *d) {
+	struct block *b;
+
+	lock_acquire (&d->lock);
+	b = desc_take (d);
+	lock_release (&d->lock);
+	return b;
+}
+
+/* Gives block B back to descriptor D under its lock. */
+static void
+desc_free (struct desc *d, struct block *b) {
+	lock_acquire (&d->lock);
+	desc_put (d, b);
+	lock_release (&d->lock);
+}
+
+/* Moves up to MAG_BATCH blocks from descriptor D into empty
+   magazine M. */
+static void
+mag_refill (struct desc *d, struct magazine *m) {
+	ASSERT (m->cnt == 0);
+
+	lock_acquire (&d->lock);
+	while (m->cnt < MAG_BATCH) {
+		struct block *b = desc_take (d);
+		if (b == NULL)
+			break;
+		m->blocks[m->cnt++] = b;
+	}
+	lock_release (&d->lock);
+}
+
+/* Gives the CNT oldest blocks in magazine M back to descriptor
+   D. */
+static void
+mag_flush (struct desc *d, struct magazine *m, size_t cnt) {
+	size_t i;
+
+	ASSERT (cnt <= m->cnt);
+	if (cnt == 0)
+		return;
+
+	lock_acquire (&d->lock);
+	for (i = 0; i < cnt; i++)
+		desc_put (d, m->blocks[i]);
+	lock_release (&d->lock);
+
+	m->cnt -= cnt;
+	memmove (m->blocks, m->blocks + cnt, m->cnt * sizeof *m->blocks);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
@@ -3,16 +3,24 @@
 #include <string.h>
 #include "threads/init.h"
 #include "threads/pte.h"
+#include "threads/pageops.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Returns the entry that maps VA in page directory PGDIR: the
+ * PDE itself if it is a large page, otherwise the PTE, and stores
+ * the number of bytes the entry maps into *SIZE. */
 static uint64_t *
-pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
+pgdir_walk (uint64_t *pdp, const uint64_t va, int create, size_t *size) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		if ((uint64_t) pte & PTE_P && (uint64_t) pte & PTE_PS) {
+			*size = LARGE_PGSIZE;
+			return &pdp[idx];
+		}
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -23,18 +31,23 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
+		*size = PGSIZE;
 		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
 	}
 	return NULL;
 }
 
 static uint64_t *
-pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
+pdpe_walk (uint64_t *pdpe, const uint64_t va, int create, size_t *size) {
 	uint64_t *pte = NULL;
 	int idx = PDPE (va);
 	int allocated = 0;
 	if (pdpe) {
 		uint64_t *pde = (uint64_t *) pdpe[idx];
+		if ((uint64_t) pde & PTE_P && (uint64_t) pde & PTE_PS) {
+			*size = HUGE_PGSIZE;
+			return &pdpe[idx];
+		}
 		if (!((uint64_t) pde & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -46,7 +59,7 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
-		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
+		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create, size);
 	}
 	if (pte == NULL && allocated) {
 		palloc_free_page ((void *) ptov (PTE_ADDR (pdpe[idx])));
@@ -55,18 +68,11 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 	return pte;
 }
 
-/* Returns the address of the page table entry for virtual
- * address VADDR in page map level 4, pml4.
- * If PML4E does not have a page table for VADDR, behavior depends
- * on CREATE.  If CREATE is true, then a new page table is
- * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. */
-/* pml4e에 가상 주소 VADDR에 대한 페이지 테이블 항목의 주소를 반환합니다.
- * PML4E에 VADDR에 대한 페이지 테이블이 없는 경우 동작은 CREATE에 따라 달라집니다.
- * CREATE가 true인 경우 새 페이지 테이블이 생성되고 그것을 가리키는 포인터가 반환됩니다.
- * 그렇지 않으면 null 포인터가 반환됩니다. */
-uint64_t *
-pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
+/* Like pml4e_walk(), but also stores the number of bytes mapped
+ * by the returned entry into *SIZE: PGSIZE for a PTE,
+ * LARGE_PGSIZE or HUGE_PGSIZE for a large PDE or PDPE. */
+static uint64_t *
+leaf_walk (uint64_t *pml4e, const uint64_t va, int create, size_t *size) {
 	uint64_t *pte = NULL;
 	int idx = PML4 (va);
 	int allocated = 0;
@@ -83,7 +89,7 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
-		pte = pdpe_walk (ptov (PTE_ADDR (pml4e[idx])), va, create);
+		pte = pdpe_walk (ptov (PTE_ADDR (pml4e[idx])), va, create, size);
 	}
 	if (pte == NULL && allocated) {
 		palloc_free_page ((void *) ptov (PTE_ADDR (pml4e[idx])));
@@ -92,6 +98,25 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the address of the page table entry for virtual
+ * address VADDR in page map level 4, pml4.
+ * If PML4E does not have a page table for VADDR, behavior depends
+ * on CREATE.  If CREATE is true, then a new page table is
+ * created and a pointer into it is returned.  Otherwise, a null
+ * pointer is returned.
+ * If VADDR is mapped by a large page, the PDE or PDPE that maps
+ * it is returned instead; see is_large_pte(). */
+/* pml4e에 가상 주소 VADDR에 대한 페이지 테이블 항목의 주소를 반환합니다.
+ * PML4E에 VADDR에 대한 페이지 테이블이 없는 경우 동작은 CREATE에 따라 달라집니다.
+ * CREATE가 true인 경우 새 페이지 테이블이 생성되고 그것을 가리키는 포인터가 반환됩니다.
+ * 그렇지 않으면 null 포인터가 반환됩니다.
+ * VADDR이 큰 페이지로 매핑되어 있으면 그 PDE 또는 PDPE가 대신 반환됩니다. */
+uint64_t *
+pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
+	size_t size;
+	return leaf_walk (pml4e, va, create, &size);
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -102,7 +127,7 @@ uint64_t *
 pml4_create (void) {
 	uint64_t *pml4 = palloc_get_page (0);
 	if (pml4)
-		memcpy (pml4, base_pml4, PGSIZE);
+		copy_page (pml4, base_pml4);
 	return pml4;
 }
 
@@ -128,7 +153,13 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (((uint64_t) pte) & PTE_P && pdp[i] & PTE_PS) {
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -141,7 +172,12 @@ pdp_for_each (uint64_t *pdp,
 		pte_for_each_func *func, void *aux, unsigned pml4_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pde) & PTE_P)
+		if (((uint64_t) pde) & PTE_P && pdp[i] & PTE_PS) {
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) i << PDPESHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pde) & PTE_P)
 			if (!pgdir_for_each ((uint64_t *) PTE_ADDR (pde), func,
 					 aux, pml4_index, i))
 				return false;
@@ -149,8 +185,10 @@ pdp_for_each (uint64_t *pdp,
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
-/* 커널을 포함한 각 사용 가능한 pte 항목에 FUNC를 적용합니다. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * A large page is passed to FUNC once, as its PDE or PDPE. */
+/* 커널을 포함한 각 사용 가능한 pte 항목에 FUNC를 적용합니다.
+ * 큰 페이지는 그 PDE 또는 PDPE로 한 번만 전달됩니다. */
 bool
 pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
@@ -176,7 +214,10 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (((uint64_t) pte) & PTE_P && pdp[i] & PTE_PS)
+			palloc_free_multiple ((void *) PTE_ADDR (pte),
+					LARGE_PGSIZE / PGSIZE);
+		else if (((uint64_t) pte) & PTE_P)
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -186,6 +227,8 @@ static void
 pdpe_destroy (uint64_t *pdpe) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdpe[i]);
+		/* User memory is never mapped with 1 GB pages. */
+		ASSERT (!(pdpe[i] & PTE_PS));
 		if (((uint64_t) pde) & PTE_P)
 			pgdir_destroy ((void *) PTE_ADDR (pde));
 	}
@@ -226,10 +269,12 @@ void *
 pml4_get_page (uint64_t *pml4, const void *uaddr) {
 	ASSERT (is_user_vaddr (uaddr));
 
-	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
+	size_t size;
+	uint64_t *pte = leaf_walk (pml4, (uint64_t) uaddr, 0, &size);
 
 	if (pte && (*pte & PTE_P))
-		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+		return ptov (PTE_ADDR (*pte) & ~(size - 1))
+			+ ((uint64_t) uaddr & (size - 1));
 	return NULL;
 }
 
@@ -240,12 +285,12 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
  * If WRITABLE is true, the new page is read/write;
  * otherwise it is read-only.
  * Returns true if successful, false if memory allocation
- * failed. */
+ * failed or UPAGE lies inside a large page. */
 
 /* 사용자 가상 페이지 UPAGE에서 커널 가상 주소 KPAGE로 식별된 물리 프레임에 대한 페이지 맵 레벨 4 PML4에 매핑을 추가합니다.
  * UPAGE는 이미 매핑되어 있으면 안 됩니다. KPAGE는 아마도 palloc_get_page()로 사용자 풀에서 얻은 페이지여야 합니다.
  * WRITABLE이 true인 경우 새 페이지는 읽기/쓰기이고, 그렇지 않으면 읽기 전용입니다.
- * 성공하면 true, 메모리 할당에 실패하면 false를 반환합니다. */
+ * 성공하면 true, 메모리 할당에 실패하거나 UPAGE가 큰 페이지 안에 있으면 false를 반환합니다. */
 bool
 pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	ASSERT (pg_ofs (upage) == 0);
@@ -253,20 +298,115 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	ASSERT (is_user_vaddr (upage));
 	ASSERT (pml4 != base_pml4);
 
-	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
+	size_t size;
+	uint64_t *pte = leaf_walk (pml4, (uint64_t) upage, 1, &size);
+
+	if (pte == NULL || size != PGSIZE)
+		return false;
+	*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	return true;
+}
+
+/* Returns the page directory that maps VA in PML4, creating the
+ * intermediate tables as needed.  Returns a null pointer if
+ * memory allocation fails or VA lies inside a 1 GB page. */
+static uint64_t *
+pgdir_lookup (uint64_t *pml4, uint64_t va) {
+	uint64_t *table = pml4;
+	unsigned idx[] = { PML4 (va), PDPE (va) };
+
+	for (int i = 0; i < 2; i++) {
+		uint64_t *entry = &table[idx[i]];
+		if (!(*entry & PTE_P)) {
+			uint64_t *new_page = palloc_get_page (PAL_ZERO);
+			if (new_page == NULL)
+				return NULL;
+			*entry = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		} else if (*entry & PTE_PS)
+			return NULL;
+		table = ptov (PTE_ADDR (*entry));
+	}
+	return table;
+}
+
+/* Maps the 2 MB of virtual memory at VA in PML4 to the 2 MB of
+ * physical memory at PA with a single large PDE, whose flags are
+ * FLAGS plus PTE_P.  VA and PA must be LARGE_PGSIZE-aligned.  A
+ * page table left under VA's PDE with nothing present in it is
+ * freed and replaced.
+ * Returns true if successful, false if memory allocation failed
+ * or part of VA's range is already mapped. */
+/* PML4에서 가상 주소 VA부터 2 MB를 물리 주소 PA부터 2 MB에 하나의 큰 PDE로 매핑한다.
+ * 플래그는 FLAGS에 PTE_P를 더한 것이다. VA와 PA는 LARGE_PGSIZE에 정렬되어야 한다.
+ * VA의 PDE 아래에 아무것도 매핑하지 않은 페이지 테이블이 남아 있으면 해제하고 대체한다.
+ * 성공하면 true, 메모리 할당에 실패하거나 VA 범위의 일부가 이미 매핑되어 있으면 false를 반환한다. */
+bool
+pml4_map_large (uint64_t *pml4, uint64_t va, uint64_t pa, uint64_t flags) {
+	ASSERT (va % LARGE_PGSIZE == 0);
+	ASSERT (pa % LARGE_PGSIZE == 0);
+
+	uint64_t *pgdir = pgdir_lookup (pml4, va);
+	uint64_t *pde;
+
+	if (pgdir == NULL)
+		return false;
+	pde = &pgdir[PDX (va)];
+	if (*pde & PTE_P) {
+		uint64_t *pt = ptov (PTE_ADDR (*pde));
+
+		if (*pde & PTE_PS)
+			return false;
+		for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+			if (pt[i] & PTE_P)
+				return false;
+		*pde = 0;
+		palloc_free_page (pt);
+		if (rcr3 () == vtop (pml4))
+			invlpg (va);
+	}
+	*pde = pa | flags | PTE_PS | PTE_P;
+	return true;
+}
 
-	if (pte)
-		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
-	return pte != NULL;
+/* If VA lies inside a 2 MB page in PML4, replaces the large PDE
+ * with a page table that maps the same memory with 4 kB pages
+ * and the same flags, including the accessed and dirty bits, so
+ * that the pages can be unmapped or changed one at a time.
+ * Returns false if memory allocation fails, true otherwise. */
+/* PML4에서 VA가 2 MB 페이지 안에 있으면 큰 PDE를 같은 메모리를 같은 플래그(accessed, dirty 비트 포함)의
+ * 4 kB 페이지로 매핑하는 페이지 테이블로 바꿔서, 페이지를 하나씩 해제하거나 바꿀 수 있게 한다.
+ * 메모리 할당에 실패하면 false, 그 외에는 true를 반환한다. */
+bool
+pml4_split_large (uint64_t *pml4, const void *va) {
+	size_t size;
+	uint64_t *pde = leaf_walk (pml4, (uint64_t) va, 0, &size);
+	uint64_t *pt, pa, flags;
+
+	if (pde == NULL || size != LARGE_PGSIZE || !(*pde & PTE_P))
+		return true;
+
+	pt = palloc_get_page (0);
+	if (pt == NULL)
+		return false;
+	pa = PTE_ADDR (*pde) & ~(LARGE_PGSIZE - 1);
+	flags = *pde & PTE_FLAGS & ~PTE_PS;
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+
+	if (rcr3 () == vtop (pml4))
+		invlpg ((uint64_t) va);
+	return true;
 }
 
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
- * UPAGE need not be mapped. */
+ * UPAGE need not be mapped.  If UPAGE lies inside a large page,
+ * the whole large page becomes not present. */
 /* 사용자 가상 페이지 UPAGE를 페이지 디렉토리 PD에서 "없음"으로 표시합니다.
  * 나중에 페이지에 대한 액세스는 오류가 발생합니다. 페이지 테이블 항목의 다른 비트는 보존됩니다.
- * UPAGE가 매핑되어 있지 않아도 됩니다. */
+ * UPAGE가 매핑되어 있지 않아도 됩니다. UPAGE가 큰 페이지 안에 있으면 큰 페이지 전체가 없음으로 표시됩니다. */
 
 void
 pml4_clear_page (uint64_t *pml4, void *upage) {
@@ -342,3 +482,20 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 			invlpg ((uint64_t) vpage);
 	}
 }
+
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PML4. */
+/* PML4의 가상 페이지 VPAGE에 대한 PTE의 쓰기 가능 비트를 WRITABLE로 설정합니다. */
+void
+pml4_set_writable (uint64_t *pml4, const void *vpage, bool writable) {
+	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	if (pte) {
+		if (writable)
+			*pte |= PTE_W;
+		else
+			*pte &= ~(uint64_t) PTE_W;
+
+		if (rcr3 () == vtop (pml4))
+			invlpg ((uint64_t) vpage);
+	}
+}
@@ -2,6 +2,7 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -9,7 +10,10 @@
 #include <string.h>
 #include "threads/init.h"
 #include "threads/loader.h"
+#include "threads/pageops.h"
+#include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,13 +28,66 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy system.  Its free pages are kept
+   as blocks of 2**ORDER pages, aligned to their size relative to
+   the pool base, on one free list per order.  A request for N
+   pages takes a block of the smallest order that fits, splitting
+   a larger one if needed, and returns the pages beyond N to the
+   free lists.  Freeing merges a block with its buddy, the block
+   it was split from, for as long as the buddy is free too.  Both
+   take O(log n) list operations for a pool of n pages.
+
+   Per-page state lives in an array beside the used_map, so free
+   pages themselves are never touched.  The used_map bitmap only
+   records which pages are in use, to catch double frees.
+
+   Each pool also keeps up to ZERO_HIGH pages that are already
+   filled with zeros, taken out of the buddy system, so that
+   single-page PAL_ZERO requests skip clearing them.  The idle
+   thread zeroes one page at a time whenever it has nothing else
+   to do, and a background "zeroer" thread (see
+   thread_set_background()) refills the pool once it drops below
+   ZERO_LOW pages.  Neither dips into the last
+   ZERO_HIGH free pages, and a request that cannot otherwise be
+   met takes the zeroed pages back first. */
+
+/* Number of block orders, enough for pools of up to 2**20 pages
+   (4 GB). */
+#define BUDDY_ORDERS 21
+
+/* buddy_page order of a page that does not head a free block. */
+#define NOT_FREE 0xff
+
+/* buddy_page order of a page on a zeroed list. */
+#define ZEROED 0xfe
+
+/* Zeroed pages to keep per pool, and the level below which the
+   zeroer thread is woken. */
+#define ZERO_HIGH 32
+#define ZERO_LOW 8
+
+/* State of one page of a pool. */
+struct buddy_page {
+	struct list_elem elem;          /* Free or zeroed list element. */
+	uint8_t order;                  /* Block order if free head, ZEROED,
+	                                   or NOT_FREE. */
+};
 
 /* A memory pool. */
 struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	struct buddy_page *pages;       /* State of each page. */
+	struct list free[BUDDY_ORDERS]; /* Free blocks of each order. */
+	size_t free_cnt;                /* Number of free pages. */
+	struct list zeroed;             /* Pages filled with zeros. */
+	size_t zeroed_cnt;              /* Number of pages in ZEROED. */
+	size_t zeroed_min;              /* Lowest ZEROED_CNT left by a hit. */
+	uint64_t zero_hits;             /* PAL_ZERO pages from ZEROED. */
+	uint64_t zero_misses;           /* PAL_ZERO pages cleared on demand. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +99,20 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void seed_pool (struct pool *);
+static bool palloc_zero_one (struct pool *);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static size_t buddy_alloc_aligned (struct pool *, size_t page_cnt);
+static void *get_pages (enum palloc_flags, size_t page_cnt, bool aligned);
+static size_t zeroed_pop (struct pool *);
+static void zeroed_drain (struct pool *);
+static void *zero_take (struct pool *);
+static void zero_put (struct pool *, void *page);
+
+/* Upped to wake the zeroer thread, once it is running. */
+static struct semaphore zero_sema;
+static bool zeroer_running;
 
 /* multiboot info */
 struct multiboot_info {
@@ -232,6 +303,9 @@ split:
 			}
 		}
 	}
+
+	seed_pool (&kernel_pool);
+	seed_pool (&user_pool);
 }
 
 /* Initializes the page allocator and get the memory size */
@@ -268,12 +342,58 @@ palloc_init (void) {
    이 경우 커널이 패닉합니다. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
+	return get_pages (flags, page_cnt, false);
+}
+
+/* Like palloc_get_multiple(), but PAGE_CNT must be a power of 2
+   and the pages returned start at a physical address that is a
+   multiple of PAGE_CNT * PGSIZE, as a large page mapping
+   requires. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt) {
+	ASSERT (page_cnt > 0 && (page_cnt & (page_cnt - 1)) == 0);
+	return get_pages (flags, page_cnt, true);
+}
+
+/* Common body of palloc_get_multiple() and palloc_get_aligned(). */
+static void *
+get_pages (enum palloc_flags flags, size_t page_cnt, bool aligned) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t page_idx = BITMAP_ERROR;
+	bool zeroed = false, wake;
+	void *pages;
+
+	if (page_cnt == 0)
+		return NULL;
 
 	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	if ((flags & PAL_ZERO) && page_cnt == 1) {
+		if (pool->zeroed_cnt > 0) {
+			page_idx = zeroed_pop (pool);
+			zeroed = true;
+			pool->zero_hits++;
+		} else
+			pool->zero_misses++;
+	}
+	if (!zeroed) {
+		page_idx = aligned ? buddy_alloc_aligned (pool, page_cnt)
+		                   : buddy_alloc (pool, page_cnt);
+		if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0) {
+			/* Out of memory: give the zeroed pages back and retry. */
+			zeroed_drain (pool);
+			page_idx = aligned ? buddy_alloc_aligned (pool, page_cnt)
+			                   : buddy_alloc (pool, page_cnt);
+		}
+		if (page_idx != BITMAP_ERROR) {
+			ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+			bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+		}
+	}
+	wake = (flags & PAL_ZERO) && zeroer_running && pool->zeroed_cnt < ZERO_LOW
+	       && pool->free_cnt > ZERO_HIGH;
 	lock_release (&pool->lock);
-	void *pages;
+	if (wake)
+		sema_up (&zero_sema);
 
 	if (page_idx != BITMAP_ERROR)
 		pages = pool->base + PGSIZE * page_idx;
@@ -281,8 +401,12 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 		pages = NULL;
 
 	if (pages) {
-		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+		if ((flags & PAL_ZERO) && !zeroed) {
+			size_t i;
+
+			for (i = 0; i < page_cnt; i++)
+				clear_page ((uint8_t *) pages + PGSIZE * i);
+		}
 	} else {
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
@@ -332,8 +456,11 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	lock_acquire (&pool->lock);
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	buddy_free (pool, page_idx, page_cnt);
+	lock_release (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -342,6 +469,122 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Stores the free page count and the size of the largest free
+   block of the user pool, if PAL_USER is set in FLAGS, or else
+   of the kernel pool, in *STATS. */
+void
+palloc_get_stats (enum palloc_flags flags, struct palloc_stats *stats) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	int order;
+
+	lock_acquire (&pool->lock);
+	stats->free_cnt = pool->free_cnt;
+	stats->largest = 0;
+	for (order = BUDDY_ORDERS - 1; order >= 0; order--)
+		if (!list_empty (&pool->free[order])) {
+			stats->largest = (size_t) 1 << order;
+			break;
+		}
+	lock_release (&pool->lock);
+}
+
+/* Zeroes pages for the zeroed lists whenever woken by
+   palloc_get_multiple(). */
+static void
+zeroer (void *aux UNUSED) {
+	thread_set_background ();
+	for (;;) {
+		sema_down (&zero_sema);
+		while (palloc_zero_one (&kernel_pool) || palloc_zero_one (&user_pool))
+			continue;
+	}
+}
+
+/* Starts the zeroer thread.  Must be called after
+   thread_start(). */
+void
+palloc_zero_init (void) {
+	sema_init (&zero_sema, 0);
+	if (thread_create ("zeroer", PRI_MIN, zeroer, NULL) != TID_ERROR)
+		zeroer_running = true;
+}
+
+/* Zeroes one free page of P and puts it on P's zeroed list, if
+   P is below ZERO_HIGH zeroed pages and has more than ZERO_HIGH
+   free pages.  Returns true if it did. */
+static bool
+palloc_zero_one (struct pool *p) {
+	void *page;
+
+	lock_acquire (&p->lock);
+	page = zero_take (p);
+	lock_release (&p->lock);
+	if (page == NULL)
+		return false;
+
+	clear_page (page);
+
+	lock_acquire (&p->lock);
+	zero_put (p, page);
+	lock_release (&p->lock);
+	return true;
+}
+
+/* Called by the idle thread with interrupts off.  Zeroes one
+   page for a pool that wants one, with interrupts on while it
+   does, and returns with interrupts off.  Returns true if there
+   may be more to do.
+
+   The idle thread must never block, so it only touches a pool
+   whose lock is free, and only with interrupts off so that it
+   cannot be preempted while holding the lock.  A page zeroed
+   while the lock became busy is kept for the next call. */
+bool
+palloc_idle_zero (void) {
+	static struct pool *pending_pool;
+	static void *pending;
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+	size_t i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (pending == NULL) {
+		for (i = 0; i < sizeof pools / sizeof *pools && pending == NULL; i++)
+			if (lock_try_acquire (&pools[i]->lock)) {
+				pending = zero_take (pools[i]);
+				pending_pool = pools[i];
+				lock_release (&pools[i]->lock);
+			}
+		if (pending == NULL)
+			return false;
+
+		intr_enable ();
+		clear_page (pending);
+		intr_disable ();
+	}
+
+	if (!lock_try_acquire (&pending_pool->lock))
+		return false;
+	zero_put (pending_pool, pending);
+	lock_release (&pending_pool->lock);
+	pending = NULL;
+	return true;
+}
+
+/* Prints statistics about the zeroed page lists. */
+void
+palloc_print_stats (void) {
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+	const char *names[] = { "kernel", "user" };
+	size_t i;
+
+	for (i = 0; i < sizeof pools / sizeof *pools; i++)
+		printf ("Zeroed %s pages: %llu hits, %llu misses, %zu of %d ready "
+		        "(low water %zu)\n",
+		        names[i], pools[i]->zero_hits, pools[i]->zero_misses,
+		        pools[i]->zeroed_cnt, ZERO_HIGH, pools[i]->zeroed_min);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -350,15 +593,209 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t pg_bytes = DIV_ROUND_UP (pgcnt * sizeof *p->pages, PGSIZE) * PGSIZE;
+	size_t i;
+	int order;
 
 	lock_init(&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
+	p->pages = (struct buddy_page *) ((uint8_t *) *bm_base + bm_pages);
+	for (order = 0; order < BUDDY_ORDERS; order++)
+		list_init (&p->free[order]);
+	p->free_cnt = 0;
+	list_init (&p->zeroed);
+	p->zeroed_cnt = 0;
+	p->zeroed_min = ZERO_HIGH;
+	p->zero_hits = p->zero_misses = 0;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	for (i = 0; i < pgcnt; i++)
+		p->pages[i].order = NOT_FREE;
+
+	*bm_base += bm_pages + pg_bytes;
+}
+
+/* Puts every page that populate_pools() marked usable in P's
+   used_map on P's free lists. */
+static void
+seed_pool (struct pool *p) {
+	size_t page_cnt = bitmap_size (p->used_map);
+	size_t idx = 0;
+
+	while (idx < page_cnt) {
+		size_t start = bitmap_scan (p->used_map, idx, 1, false);
+		size_t end;
+
+		if (start == BITMAP_ERROR)
+			break;
+		for (end = start; end < page_cnt && !bitmap_test (p->used_map, end); end++)
+			continue;
+		buddy_free (p, start, end - start);
+		idx = end;
+	}
+}
+
+/* Adds the free block of 2**ORDER pages at IDX to P. */
+static void
+block_push (struct pool *p, size_t idx, int order) {
+	p->pages[idx].order = order;
+	list_push_front (&p->free[order], &p->pages[idx].elem);
+}
+
+/* Removes the free block at IDX from P's free lists. */
+static void
+block_remove (struct pool *p, size_t idx) {
+	list_remove (&p->pages[idx].elem);
+	p->pages[idx].order = NOT_FREE;
+}
+
+/* Frees the PAGE_CNT pages of P starting at PAGE_IDX, as the
+   largest aligned blocks that fit, merging each with its buddy
+   while the buddy is free.  The pages may be any range, not only
+   a whole block handed out by buddy_alloc(). */
+static void
+buddy_free (struct pool *p, size_t page_idx, size_t page_cnt) {
+	size_t pool_cnt = bitmap_size (p->used_map);
+
+	p->free_cnt += page_cnt;
+	while (page_cnt > 0) {
+		size_t idx = page_idx;
+		int order = 0;
+
+		/* Largest block aligned at PAGE_IDX within the range. */
+		while (order + 1 < BUDDY_ORDERS
+		       && (page_idx & ((size_t) 1 << order)) == 0
+		       && ((size_t) 2 << order) <= page_cnt)
+			order++;
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+
+		/* Merge with free buddies. */
+		for (; order + 1 < BUDDY_ORDERS; order++) {
+			size_t buddy = idx ^ ((size_t) 1 << order);
+
+			if (buddy + ((size_t) 1 << order) > pool_cnt
+			    || p->pages[buddy].order != order)
+				break;
+			block_remove (p, buddy);
+			if (buddy < idx)
+				idx = buddy;
+		}
+		block_push (p, idx, order);
+	}
+}
+
+/* Allocates PAGE_CNT contiguous pages from P and returns the
+   index of the first one, or BITMAP_ERROR if no free block is
+   large enough. */
+static size_t
+buddy_alloc (struct pool *p, size_t page_cnt) {
+	int want, order;
+	size_t idx;
+
+	for (want = 0; ((size_t) 1 << want) < page_cnt; want++)
+		if (want + 1 == BUDDY_ORDERS)
+			return BITMAP_ERROR;
+	for (order = want; order < BUDDY_ORDERS; order++)
+		if (!list_empty (&p->free[order]))
+			break;
+	if (order == BUDDY_ORDERS)
+		return BITMAP_ERROR;
+
+	idx = list_entry (list_front (&p->free[order]), struct buddy_page, elem) - p->pages;
+	block_remove (p, idx);
+
+	/* Split down to the order wanted, keeping the lower half. */
+	while (order > want) {
+		order--;
+		block_push (p, idx + ((size_t) 1 << order), order);
+	}
+
+	/* Give back the pages beyond PAGE_CNT. */
+	p->free_cnt -= (size_t) 1 << want;
+	if (page_cnt < ((size_t) 1 << want))
+		buddy_free (p, idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+	return idx;
+}
+
+/* Allocates PAGE_CNT contiguous pages from P, a power of 2,
+   aligned to PAGE_CNT pages in physical memory, and returns the
+   index of the first one, or BITMAP_ERROR if no free block is
+   large enough.  Blocks are only aligned relative to the pool
+   base, so unless the base happens to be aligned too this takes
+   a block twice as large and gives back the pages on either side
+   of the aligned run inside it. */
+static size_t
+buddy_alloc_aligned (struct pool *p, size_t page_cnt) {
+	size_t skew = pg_no (vtop (p->base)) & (page_cnt - 1);
+	size_t idx, page_idx;
+
+	if (skew == 0)
+		return buddy_alloc (p, page_cnt);
+
+	idx = buddy_alloc (p, 2 * page_cnt);
+	if (idx == BITMAP_ERROR)
+		return BITMAP_ERROR;
+	page_idx = idx + page_cnt - skew;
+	buddy_free (p, idx, page_idx - idx);
+	buddy_free (p, page_idx + page_cnt, skew);
+	return page_idx;
+}
+
+/* Takes the most recently zeroed page off P's zeroed list and
+   returns its index.  The page stays marked used in the
+   used_map. */
+static size_t
+zeroed_pop (struct pool *p) {
+	size_t idx;
+
+	idx = list_entry (list_pop_front (&p->zeroed), struct buddy_page, elem) - p->pages;
+	ASSERT (p->pages[idx].order == ZEROED);
+	p->pages[idx].order = NOT_FREE;
+	if (--p->zeroed_cnt < p->zeroed_min)
+		p->zeroed_min = p->zeroed_cnt;
+	return idx;
+}
+
+/* Returns every page on P's zeroed list to the free lists. */
+static void
+zeroed_drain (struct pool *p) {
+	while (p->zeroed_cnt > 0) {
+		size_t idx = zeroed_pop (p);
+
+		bitmap_set (p->used_map, idx, false);
+		buddy_free (p, idx, 1);
+	}
+}
+
+/* Takes a free page of P to be zeroed, or returns a null pointer
+   if P already has ZERO_HIGH zeroed pages or is short of free
+   pages.  Must be called with P's lock held. */
+static void *
+zero_take (struct pool *p) {
+	size_t idx;
+
+	if (p->zeroed_cnt >= ZERO_HIGH || p->free_cnt <= ZERO_HIGH)
+		return NULL;
+	idx = buddy_alloc (p, 1);
+	if (idx == BITMAP_ERROR)
+		return NULL;
+	bitmap_mark (p->used_map, idx);
+	return p->base + PGSIZE * idx;
+}
+
+/* Puts PAGE of P, which zero_take() returned and which is now
+   filled with zeros, on P's zeroed list.  Must be called with
+   P's lock held. */
+static void
+zero_put (struct pool *p, void *page) {
+	size_t idx = pg_no (page) - pg_no (p->base);
 
-	*bm_base += bm_pages;
+	p->pages[idx].order = ZEROED;
+	list_push_front (&p->zeroed, &p->pages[idx].elem);
+	p->zeroed_cnt++;
 }
 
 /* Returns true if PAGE was allocated from POOL,
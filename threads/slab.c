@@ -0,0 +1,273 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   Each cache carves page-sized slabs into objects of a single
+   size.  A slab starts with a struct slab header, followed by
+   one free-list link per object and then the objects, so the
+   free list never overwrites an object and constructed state
+   survives a free and the next allocation.
+
+   Slabs with free objects are kept on the cache's partial list;
+   allocation takes from the front of that list, which keeps the
+   working set of slabs small.  Full slabs are on no list.  When
+   the last object of a slab is freed the slab moves to the empty
+   list, where at most one slab is kept to absorb the next
+   allocation and any others go back to the page allocator.
+
+   In front of the slabs, every cache keeps a short stack of
+   recently freed objects.  Freeing pushes onto it and
+   allocating pops from it, so an object that is freed and
+   allocated again right away, as on the fault path, costs no
+   slab bookkeeping and is likely still in the CPU cache. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab5eed
+
+/* Free-list link that ends a list. */
+#define NO_OBJ 0xffff
+
+/* Recently freed objects kept per cache. */
+#define RECENT_CNT 16
+
+/* Maximum number of caches. */
+#define CACHE_MAX 16
+
+/* Object cache. */
+struct kmem_cache {
+	const char *name;           /* Name for statistics. */
+	size_t obj_size;            /* Object size, rounded up to 8. */
+	size_t objs_per_slab;       /* Number of objects in a slab. */
+	size_t obj_ofs;             /* Offset of the first object in a slab. */
+	kmem_ctor_func *ctor;       /* Constructor, or null. */
+	struct lock lock;           /* Lock. */
+	struct list partial;        /* Slabs with free and used objects. */
+	struct list empty;          /* Slabs with no used objects. */
+	void *recent[RECENT_CNT];   /* Recently freed objects. */
+	size_t recent_cnt;          /* Number of objects in RECENT. */
+
+	/* Statistics. */
+	size_t slab_cnt;            /* Slabs owned. */
+	size_t in_use;              /* Objects allocated and not freed. */
+	size_t peak;                /* Maximum of IN_USE. */
+	uint64_t alloc_cnt;         /* Allocations. */
+	uint64_t recycled;          /* Allocations served from RECENT. */
+};
+
+/* Slab header, at the start of the slab's page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Partial or empty list element. */
+	size_t used_cnt;            /* Objects not on the free list. */
+	uint16_t free;              /* First free object, or NO_OBJ. */
+	uint16_t next[];            /* Free object following each free object. */
+};
+
+/* Our set of caches. */
+static struct kmem_cache caches[CACHE_MAX];
+static size_t cache_cnt;
+
+static struct slab *slab_create (struct kmem_cache *);
+static void slab_put (struct kmem_cache *, struct slab *, void *obj);
+static struct slab *obj_to_slab (struct kmem_cache *, void *obj);
+
+/* Creates and returns a cache named NAME of SIZE-byte objects,
+   at most PGSIZE / 8 bytes each.  If CTOR is nonnull, it is
+   called on each object when its slab is created, with the
+   cache's lock held.  Caches are never destroyed. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor) {
+	struct kmem_cache *c;
+	size_t n;
+
+	ASSERT (size > 0 && size <= PGSIZE / 8);
+	ASSERT (cache_cnt < CACHE_MAX);
+
+	c = &caches[cache_cnt++];
+	c->name = name;
+	c->obj_size = ROUND_UP (size, sizeof (void *));
+	c->ctor = ctor;
+
+	/* As many objects as fit behind the header and their links. */
+	n = (PGSIZE - sizeof (struct slab)) / (c->obj_size + sizeof (uint16_t));
+	while (ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t), sizeof (void *))
+	       + n * c->obj_size > PGSIZE)
+		n--;
+	c->objs_per_slab = n;
+	c->obj_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+	                       sizeof (void *));
+
+	lock_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->empty);
+	c->recent_cnt = 0;
+	c->slab_cnt = c->in_use = c->peak = 0;
+	c->alloc_cnt = c->recycled = 0;
+	return c;
+}
+
+/* Returns the IDX'th object of slab S in cache C. */
+static inline void *
+slab_obj (struct kmem_cache *c, struct slab *s, size_t idx) {
+	return (uint8_t *) s + c->obj_ofs + idx * c->obj_size;
+}
+
+/* Obtains and returns an object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	lock_acquire (&c->lock);
+	if (c->recent_cnt > 0) {
+		obj = c->recent[--c->recent_cnt];
+		c->recycled++;
+	} else {
+		if (!list_empty (&c->partial))
+			s = list_entry (list_front (&c->partial), struct slab, elem);
+		else {
+			if (!list_empty (&c->empty))
+				s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+			else {
+				s = slab_create (c);
+				if (s == NULL) {
+					lock_release (&c->lock);
+					return NULL;
+				}
+			}
+			list_push_front (&c->partial, &s->elem);
+		}
+
+		obj = slab_obj (c, s, s->free);
+		s->free = s->next[s->free];
+		if (++s->used_cnt == c->objs_per_slab)
+			list_remove (&s->elem);
+	}
+	c->alloc_cnt++;
+	if (++c->in_use > c->peak)
+		c->peak = c->in_use;
+	lock_release (&c->lock);
+	return obj;
+}
+
+/* Gives OBJ, which must have been obtained from cache C, back to
+   C.  Does nothing if OBJ is null. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+
+	if (obj == NULL)
+		return;
+	s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   it has to stay constructed. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	lock_acquire (&c->lock);
+	ASSERT (c->in_use > 0);
+	c->in_use--;
+	if (c->recent_cnt < RECENT_CNT)
+		c->recent[c->recent_cnt++] = obj;
+	else
+		slab_put (c, s, obj);
+	lock_release (&c->lock);
+}
+
+/* Prints the statistics of every cache. */
+void
+kmem_print_stats (void) {
+	size_t i;
+
+	for (i = 0; i < cache_cnt; i++) {
+		struct kmem_cache *c = &caches[i];
+		size_t malloc_size = 16;
+
+		while (malloc_size < c->obj_size)
+			malloc_size *= 2;
+		printf ("Slab %s: %zu in use (peak %zu), %zu slabs, "
+		        "%llu allocations (%llu recycled), "
+		        "%zu bytes each (%zu with malloc)\n",
+		        c->name, c->in_use, c->peak, c->slab_cnt,
+		        c->alloc_cnt, c->recycled, c->obj_size, malloc_size);
+	}
+}
+
+/* Allocates a new slab for cache C and constructs its objects.
+   Returns a null pointer if memory is not available. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	size_t i;
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->used_cnt = 0;
+	s->free = 0;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		s->next[i] = i + 1 < c->objs_per_slab ? i + 1 : NO_OBJ;
+		if (c->ctor != NULL)
+			c->ctor (slab_obj (c, s, i));
+	}
+	c->slab_cnt++;
+	return s;
+}
+
+/* Puts OBJ back on the free list of its slab S in cache C, and
+   frees S if it is now unused and another empty slab is already
+   kept. */
+static void
+slab_put (struct kmem_cache *c, struct slab *s, void *obj) {
+	size_t idx = ((uint8_t *) obj - (uint8_t *) slab_obj (c, s, 0)) / c->obj_size;
+
+	ASSERT (s->used_cnt > 0);
+	if (s->free == NO_OBJ)
+		list_push_front (&c->partial, &s->elem);
+	s->next[idx] = s->free;
+	s->free = idx;
+
+	if (--s->used_cnt == 0) {
+		list_remove (&s->elem);
+		if (list_empty (&c->empty))
+			list_push_front (&c->empty, &s->elem);
+		else {
+			s->magic = 0;
+			palloc_free_page (s);
+			c->slab_cnt--;
+		}
+	}
+}
+
+/* Returns the slab that OBJ of cache C is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	/* Check that the slab is valid. */
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+
+	/* Check that the object is properly aligned for the slab. */
+	ASSERT (pg_ofs (obj) >= c->obj_ofs);
+	ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->obj_size == 0);
+
+	return s;
+}
@@ -31,10 +31,192 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
+
+/* With LOCKSTAT, synch.h maps lock_init() and rwlock_init() to
+   their _named variants for everyone else. */
+#undef lock_init
+#undef rwlock_init
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
+/* 중첩 기부가 거쳐갈 수 있는 잠금의 최대 개수. */
+#define DONATION_DEPTH_MAX 8
+
+static void lock_set_holder (struct lock *, struct thread *);
+static void lock_propagate (struct lock *, int depth);
+static bool donation_apply (struct thread *);
+static void donation_follow (struct thread *, int depth);
+static void donation_hold_set (struct thread *, struct lock_hold *, int donation, int depth);
+static void rwlock_wait (struct rwlock *, struct waitq *);
+static void rwlock_hold (struct rwlock *, struct thread *, struct lock_hold *);
+static void rwlock_propagate (struct rwlock *, int depth);
+static void waitq_unlink (struct waitq_elem *);
+static struct waitq_elem **leader_bucket (struct waitq *, int priority);
+static struct waitq_elem *leader_find (struct waitq *, int priority);
+static void leader_add (struct waitq_elem *);
+static void leader_del (struct waitq_elem *);
+
+/* 모든 대기 큐의 리더를 (큐, 우선순위)로 찾기 위한 해시 테이블.
+ * 각 버킷은 리더의 hash_next로 이어진 단일 연결 리스트이다.
+ * 리더의 수는 BLOCKED 스레드의 수를 넘지 않으므로 버킷은 보통 비어있거나 원소가 하나뿐이다. */
+#define LEADER_HASH_BITS 7
+static struct waitq_elem *leader_hash[1 << LEADER_HASH_BITS];
+
+/* waitq_init - 빈 대기 큐 Q를 초기화한다. */
+void waitq_init (struct waitq *q) {
+	ASSERT (q != NULL);
+
+	list_init (&q->levels);
+	q->mask = 0;
+}
+
+/* waitq_empty - Q에 기다리는 스레드가 없으면 true를 반환한다. */
+bool waitq_empty (struct waitq *q) {
+	return q->mask == 0;
+}
+
+/* waitq_max_priority - Q에서 가장 높은 대기자 우선순위를 O(1)에 반환한다.
+ * 기다리는 스레드가 없다면 PRI_MIN을 반환한다.
+ */
+int waitq_max_priority (struct waitq *q) {
+	if (q->mask == 0)
+		return PRI_MIN;
+	return 63 - __builtin_clzll (q->mask);
+}
+
+/* waitq_push - 스레드 T를 원소 E로 Q에 O(1)에 넣는다.
+ * 같은 우선순위의 리더가 있으면 그 리더의 peers 끝에 붙고(FIFO), 없으면 새 리더가 된다.
+ * 새 리더는 mask에서 찾은 바로 아래 우선순위의 리더 앞에, 그런 리더가 없으면 levels의 끝에 들어간다.
+ * 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+void waitq_push (struct waitq *q, struct waitq_elem *e, struct thread *t) {
+	uint64_t lower;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (e->queue == NULL);
+
+	e->queue = q;
+	e->thread = t;
+	e->priority = t->priority;
+	if (q->mask & (1ULL << e->priority)) {
+		e->leader = false;
+		list_push_back (&leader_find (q, e->priority)->peers, &e->elem);
+		return;
+	}
+
+	e->leader = true;
+	list_init (&e->peers);
+	lower = q->mask & ((1ULL << e->priority) - 1);
+	if (lower == 0)
+		list_push_back (&q->levels, &e->elem);
+	else
+		list_insert (&leader_find (q, 63 - __builtin_clzll (lower))->elem, &e->elem);
+	q->mask |= 1ULL << e->priority;
+	leader_add (e);
+}
+
+/* waitq_pop - Q에서 가장 높은 우선순위 중 가장 먼저 기다린 스레드를 O(1)에 꺼내 반환한다.
+ * Q는 비어있지 않아야 하고, 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+struct thread *waitq_pop (struct waitq *q) {
+	struct waitq_elem *e;
+
+	ASSERT (!list_empty (&q->levels));
+
+	e = list_entry (list_front (&q->levels), struct waitq_elem, elem);
+	waitq_remove (e);
+	return e->thread;
+}
+
+/* waitq_remove - 원소 E를 자신이 속한 큐에서 O(1)에 뺀다.
+ * 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+void waitq_remove (struct waitq_elem *e) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (e->queue != NULL);
+
+	waitq_unlink (e);
+	e->queue = NULL;
+}
+
+/* waitq_update - 기다리는 스레드의 우선순위가 바뀌었을 때 원소 E를 새 우선순위 칸으로 옮긴다.
+ * 빼는 것과 넣는 것 모두 O(1)이고, 새 칸의 맨 뒤로 들어간다.
+ * 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+void waitq_update (struct waitq_elem *e) {
+	struct waitq *q = e->queue;
+
+	ASSERT (q != NULL);
+
+	if (e->priority == e->thread->priority)
+		return;
+	waitq_remove (e);
+	waitq_push (q, e, e->thread);
+}
+
+/* waitq_unlink - 원소 E를 리스트에서 떼어낸다.
+ * 리더를 떼어낼 때는 peers의 첫 원소를 새 리더로 올리고 나머지 peers를 통째로 넘겨준다.
+ * 마지막 대기자가 떠난 우선순위는 mask에서 지운다.
+ */
+static void waitq_unlink (struct waitq_elem *e) {
+	struct waitq_elem *next;
+
+	if (!e->leader) {
+		list_remove (&e->elem);
+		return;
+	}
+	leader_del (e);
+	if (list_empty (&e->peers)) {
+		list_remove (&e->elem);
+		e->queue->mask &= ~(1ULL << e->priority);
+		return;
+	}
+	next = list_entry (list_pop_front (&e->peers), struct waitq_elem, elem);
+	next->leader = true;
+	list_init (&next->peers);
+	if (!list_empty (&e->peers))
+		list_splice (list_end (&next->peers), list_begin (&e->peers), list_end (&e->peers));
+	list_insert (&e->elem, &next->elem);
+	list_remove (&e->elem);
+	leader_add (next);
+}
+
+/* leader_bucket - 큐 Q의 PRIORITY 리더가 들어갈 해시 버킷을 반환한다. */
+static struct waitq_elem **leader_bucket (struct waitq *q, int priority) {
+	uint64_t key = (uintptr_t) q / sizeof (void *) + priority;
+
+	return &leader_hash[key * 0x9e3779b97f4a7c15ULL >> (64 - LEADER_HASH_BITS)];
+}
+
+/* leader_find - 큐 Q에서 우선순위가 PRIORITY인 리더를 반환한다. 그런 리더가 있어야 한다. */
+static struct waitq_elem *leader_find (struct waitq *q, int priority) {
+	struct waitq_elem *e;
+
+	for (e = *leader_bucket (q, priority); e != NULL; e = e->hash_next)
+		if (e->queue == q && e->priority == priority)
+			return e;
+	NOT_REACHED ();
+}
+
+/* leader_add - 리더 E를 해시 테이블에 넣는다. */
+static void leader_add (struct waitq_elem *e) {
+	struct waitq_elem **bucket = leader_bucket (e->queue, e->priority);
+
+	e->hash_next = *bucket;
+	*bucket = e;
+}
+
+/* leader_del - 리더 E를 해시 테이블에서 뺀다. */
+static void leader_del (struct waitq_elem *e) {
+	struct waitq_elem **p = leader_bucket (e->queue, e->priority);
+
+	while (*p != e)
+		p = &(*p)->hash_next;
+	*p = e->hash_next;
+}
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -49,11 +231,11 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	waitq_init (&sema->waiters);
 }
 
 /* sema_down - 세마포어에 대한 Down 또는 P 연산이다.
- * 세마포어를 얻을 수 없다면, 현재 스레드를 세마포어의 waiters 리스트에 priority 내림차순으로 삽입하고, BLOCKED 상태로 전환한다.
+ * 세마포어를 얻을 수 없다면, 현재 스레드를 세마포어의 waiters에서 자신의 우선순위 칸 끝에 넣고, BLOCKED 상태로 전환한다.
  * 그리고 세마포어 값이 양수가 될 때까지 기다렸다가 원자적으로 감소시킨다.
  * 이 함수는 BLOCKED 될 수 있으므로 인터럽트 핸들러 내에서 호출해서는 안된다.
  * 인터럽트가 비활성화된 상태에서 호출될 수 있지만, BLOCKED가 발생하면 다음 스케줄링된 스레드가 인터럽트를 다시 활성화 할 수 있다.
@@ -67,7 +249,9 @@ void sema_down(struct semaphore *sema)
 	old_level = intr_disable();
 	while (sema->value == 0)
 	{
-		list_insert_ordered(&sema->waiters, &thread_current()->elem, (list_less_func *)&higher_priority, NULL);
+		struct thread *t = thread_current();
+
+		waitq_push(&sema->waiters, &t->wait_elem, t);
 		thread_block();
 	}
 	sema->value--;
@@ -101,7 +285,7 @@ sema_try_down (struct semaphore *sema) {
 
 /* sema_up - Up 또는 세마포어에서 V 연산을 수행한다.
  * 세마포어의 값을 증가시키고, 세마포어를 기다리는 스레드가 있다면 하나를 깨운다.
- * 우선순위 기부에 의해 waiters 리스트에서의 우선순위가 내림차순에 어긋날 수 있기에, waiters 리스트를 정렬한다.
+ * 기부로 바뀐 우선순위는 thread_update_priority()가 그때그때 waiters에 반영하므로, 정렬 없이 맨 앞의 스레드를 깨운다.
  * 현재 실행 중인 스레드가 양보하고, 스케줄링된다. 스케줄러 재량에 따라 다시 같은 스레드가 실행될 수 있다.
  * 이 함수는 인터럽트 핸들러에서 호출될 수 있다.
  */
@@ -112,10 +296,8 @@ void sema_up(struct semaphore *sema)
 	ASSERT(sema != NULL);
 
 	old_level = intr_disable();
-	if (!list_empty(&sema->waiters)) {
-		list_sort(&sema->waiters, (list_less_func *)&higher_priority, NULL);
-		thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
-	}
+	if (!waitq_empty(&sema->waiters))
+		thread_unblock(waitq_pop(&sema->waiters));
 	sema->value++;
 	intr_set_level(old_level);
 	// thread_yield();
@@ -178,14 +360,30 @@ lock_init (struct lock *lock) {
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	lock->hold.donation = PRI_MIN;
+#ifdef LOCKSTAT
+	lock->name = "(unnamed)";
+	lock->stat = NULL;
+#endif
+}
+
+#ifdef LOCKSTAT
+/* lock_init_named - lock_init()과 같지만, lockstat 표에 LOCK을 NAME으로 기록한다.
+ * LOCKSTAT 빌드에서는 synch.h의 매크로가 모든 lock_init() 호출을 이 함수로 바꾼다.
+ */
+void lock_init_named (struct lock *lock, const char *name) {
+	lock_init (lock);
+	lock->name = name;
 }
+#endif
 
 /* lock_acquire - 잠금을 획득하고 필요한 경우 잠금을 사용할 수 있을 때까지 대기한다.
  * 잠금은 현재 스레드가 이미 보유하고 있지 않아야 한다.
  *
- * 잠금을 획득하지 못할 경우, 해당 잠금을 wait_on_lock에 저장한다.
- * 이후, 현재 스레드의 우선순위가 잠금을 보유하고 있는 스레드의 우선순위보다 높을 경우,
- * 잠금을 보유하고 있는 스레드의 donations 리스트에 현재 스레드를 추가하고 중첩 기부를 수행한다.
+ * 잠금을 획득하지 못할 경우, 해당 잠금을 wait_on_lock에 저장하고 잠금 세마포어의 waiters에 현재 스레드를 추가한다.
+ * waiters가 곧 기부자 집합이며, 가장 높은 우선순위가 바뀌면 보유자의 우선순위를 다시 계산하고, 보유자도 다른 잠금을 기다리고 있다면
+ * 최대 DONATION_DEPTH_MAX 단계까지 중첩 기부를 전파한다.
+ * 잠금을 획득하면 남아있는 waiters는 새 보유자에게 기부한다.
  * 
  * 이 함수는 BLOCKED 될 수 있으므로 인터럽트 핸들러 내에서 호출해서는 안된다.
  * 이 함수는 인터럽트가 비활성화된 상태에서 호출될 수 있지만, Sleep이 필요하면 인터럽트가 다시 활성화된다.
@@ -194,29 +392,39 @@ lock_init (struct lock *lock) {
  */
 void lock_acquire (struct lock *lock) {
 	struct thread *t = thread_current();
-	struct thread *holder;
+	struct semaphore *sema = &lock->semaphore;
+	enum intr_level old_level;
+#ifdef LOCKSTAT
+	uint64_t wait_start;
+	bool contended;
+#endif
 	
 	ASSERT(lock != NULL);
 	ASSERT(!intr_context());
 	ASSERT(!lock_held_by_current_thread(lock));
 
-	if (lock->holder != NULL) {
-		t->wait_on_lock = lock;
-		if (thread_get_priority() > lock->holder->priority && !thread_mlfqs) {
-			list_insert_ordered(&lock->holder->donations, &t->d_elem, (list_less_func *)&higher_priority, NULL);
-			while (t->wait_on_lock != NULL) {
-				holder = t->wait_on_lock->holder;
-				if (t->priority > holder->priority) {
-					holder->priority = t->priority;
-					t = holder;
-				}
-				else break;
-			}
+	old_level = intr_disable();
+#ifdef LOCKSTAT
+	wait_start = rdtsc();
+	contended = sema->value == 0;
+#endif
+	while (sema->value == 0) {
+		waitq_push(&sema->waiters, &t->wait_elem, t);
+		if (!thread_mlfqs) {
+			t->wait_on_lock = lock;
+			lock_propagate(lock, 1);
 		}
+		thread_block();
 	}
-	sema_down(&lock->semaphore);
-	thread_current()->wait_on_lock = NULL;
-	lock->holder = thread_current();
+	sema->value--;
+	t->wait_on_lock = NULL;
+	lock_set_holder(lock, t);
+#ifdef LOCKSTAT
+	lock->acquired = rdtsc();
+	lock->stat = lockstat_acquired(lock->name, __builtin_return_address(0),
+	                               wait_start, lock->acquired, contended);
+#endif
+	intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -227,51 +435,139 @@ void lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
-	if (success)
-		lock->holder = thread_current ();
+	if (success) {
+		lock_set_holder (lock, thread_current ());
+#ifdef LOCKSTAT
+		lock->acquired = rdtsc ();
+		lock->stat = lockstat_acquired (lock->name, __builtin_return_address (0),
+		                                lock->acquired, lock->acquired, false);
+#endif
+	}
+	intr_set_level (old_level);
 	return success;
 }
 
 /* lock_release - 현재 스레드가 소유하고 있는 잠금을 해제한다.
  *
- * 잠금이 해제되면, 해당 잠금을 가지고 있던 스레드의 donations 리스트에서 해당 잠금을 기다리고 있던 스레드를 삭제한다.
- * 그리고 다중 기부를 수행하기 위해 donations 리스트를 검사하여 현재 스레드의 우선순위를 재설정한다.
- * 만약 donations 리스트가 비어있지 않다면, 현재 스레드의 우선순위를 donations 리스트의 가장 높은 우선순위로 설정하고,
- * donations 리스트가 비어있다면, 현재 스레드의 우선순위를 원래의 우선순위로 설정한다.
+ * 잠금이 해제되면, 현재 스레드의 held_locks에서 해당 잠금을 제거한다. 해당 잠금의 waiters가 한꺼번에 빠지므로 O(log n)이다.
+ * 그리고 남은 잠금들 중 가장 높은 기부와 원래의 우선순위 중 큰 값으로 현재 스레드의 우선순위를 재설정한다.
  * 
  * 인터럽트 핸들러는 잠금을 획득할 수 없으므로 인터럽트 핸들러 내에서 잠금을 해제하려고 시도하는 것은 의미가 없다.
  * 
  * 고급 스케줄러 사용 시 우선순위 기부를 비활성화한다.
  */
 void lock_release (struct lock *lock) {
+	struct thread *t = thread_current();
+	enum intr_level old_level;
+
 	ASSERT(lock != NULL);
 	ASSERT(lock_held_by_current_thread(lock));
 
-	struct thread *lock_holder = lock->holder;
-	struct thread *t;
-	struct list_elem *e;
-
-	for (e = list_begin(&lock->holder->donations); e != list_end(&lock->holder->donations); e = list_next(e)) {
-		t = list_entry(e, struct thread, d_elem);
-		if (t->wait_on_lock == lock)
-			list_remove(e);
-	}
-
+	old_level = intr_disable();
 	if (!thread_mlfqs) {
-		if (!list_empty(&lock_holder->donations)) {
-			lock_holder->priority = list_entry(list_front(&lock_holder->donations), struct thread, d_elem)->priority;
-		}
-		else
-			lock_holder->priority = lock_holder->original_priority;
+		rb_remove(&t->held_locks, &lock->hold.elem);
+		donation_refresh(t);
 	}
+#ifdef LOCKSTAT
+	lockstat_released(lock->stat, lock->acquired);
+#endif
 	lock->holder = NULL;
 	sema_up (&lock->semaphore);
+	intr_set_level(old_level);
+}
+
+/* lock_set_holder - 잠금 LOCK의 보유자를 T로 설정한다.
+ * LOCK을 T의 held_locks에 넣어서, LOCK을 아직 기다리고 있는 스레드들이 T에게 기부하도록 한다.
+ * 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+static void lock_set_holder (struct lock *lock, struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	lock->holder = t;
+	if (thread_mlfqs)
+		return;
+	lock->hold.donation = waitq_max_priority (&lock->semaphore.waiters);
+	rb_insert (&t->held_locks, &lock->hold.elem);
+	donation_refresh (t);
+}
+
+/* lock_propagate - waiters가 바뀐 잠금 LOCK의 기부를 다시 계산하고, 보유자에게 반영한다.
+ * 기부가 바뀌지 않는 지점에서 멈추므로 변화가 필요한 만큼만 갱신한다.
+ * DEPTH는 지금까지 거쳐온 잠금의 개수이다.
+ */
+static void lock_propagate (struct lock *lock, int depth) {
+	int donation = waitq_max_priority (&lock->semaphore.waiters);
+
+	if (donation == lock->hold.donation)
+		return;
+	if (lock->holder == NULL) {
+		lock->hold.donation = donation;
+		return;
+	}
+	donation_hold_set (lock->holder, &lock->hold, donation, depth);
+}
+
+/* donation_refresh - 스레드 T의 우선순위를 원래의 우선순위와 T가 보유한 잠금들의 기부 중 가장 큰 값으로 다시 계산한다.
+ * 우선순위가 바뀌었고 T가 다른 잠금을 기다리고 있다면 그 잠금의 보유자에게 변화를 전파한다.
+ * 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+void donation_refresh (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (donation_apply (t))
+		donation_follow (t, 0);
+}
+
+/* donation_apply - 스레드 T의 우선순위를 다시 계산하고, 바뀌었다면 true를 반환한다.
+ * 우선순위가 바뀌면 thread_update_priority()가 waiters에서 T의 칸을 옮긴다.
+ */
+static bool donation_apply (struct thread *t) {
+	struct rb_elem *top = rb_min (&t->held_locks);
+	int priority = t->original_priority;
+
+	if (top != NULL)
+		priority = MAX (priority, rb_entry (top, struct lock_hold, elem)->donation);
+	if (priority == t->priority)
+		return false;
+
+	thread_update_priority (t, priority);
+	return true;
+}
+
+/* donation_follow - 우선순위가 바뀐 스레드 T가 기다리는 잠금이나 reader-writer 잠금으로 변화를 전파한다.
+ * 최대 DONATION_DEPTH_MAX개의 잠금을 거친다.
+ */
+static void donation_follow (struct thread *t, int depth) {
+	if (depth >= DONATION_DEPTH_MAX)
+		return;
+	if (t->wait_on_lock != NULL)
+		lock_propagate (t->wait_on_lock, depth + 1);
+	else if (t->wait_on_rwlock != NULL)
+		rwlock_propagate (t->wait_on_rwlock, depth + 1);
+}
+
+/* donation_hold_set - 스레드 T가 HOLD를 통해 받는 기부를 DONATION으로 바꾸고, T의 우선순위 변화를 전파한다.
+ */
+static void donation_hold_set (struct thread *t, struct lock_hold *hold, int donation, int depth) {
+	rb_remove (&t->held_locks, &hold->elem);
+	hold->donation = donation;
+	rb_insert (&t->held_locks, &hold->elem);
+	if (donation_apply (t))
+		donation_follow (t, depth);
+}
+
+/* lock_higher_donation - 스레드의 held_locks를 기부 내림차순으로 정렬하기 위한 비교 함수.
+ */
+bool lock_higher_donation (const struct rb_elem *a, const struct rb_elem *b, void *aux UNUSED) {
+	return rb_entry (a, struct lock_hold, elem)->donation > rb_entry (b, struct lock_hold, elem)->donation;
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -284,11 +580,243 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
-	struct semaphore semaphore;         /* This semaphore. */
-};
+/* rwlock_init - reader-writer 잠금 RW를 초기화한다.
+ * 여러 스레드가 공유 모드(읽기)로 함께 보유하거나, 한 스레드만 배타 모드(쓰기)로 보유할 수 있다.
+ * 쓰기를 기다리는 스레드가 있으면 새 읽기는 그 뒤에서 기다리므로 쓰기가 굶지 않는다.
+ */
+void rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	rw->readers = 0;
+	rw->writer = NULL;
+	waitq_init (&rw->read_waiters);
+	waitq_init (&rw->write_waiters);
+	rw->writers_pending = 0;
+	rw->donation = PRI_MIN;
+	list_init (&rw->read_holds);
+#ifdef LOCKSTAT
+	rw->name = "(unnamed)";
+	rw->write_stat = NULL;
+#endif
+}
+
+#ifdef LOCKSTAT
+/* rwlock_init_named - rwlock_init()과 같지만, lockstat 표에 RW를 NAME으로 기록한다. */
+void rwlock_init_named (struct rwlock *rw, const char *name) {
+	rwlock_init (rw);
+	rw->name = name;
+}
+#endif
+
+/* rwlock_read_acquire - RW를 공유 모드로 획득한다. 보유 중인 쓰기 스레드나 획득을 기다리는 쓰기 스레드가 있다면 기다린다.
+ * 깨어났지만 아직 실행되지 않은 쓰기 스레드도 writers_pending에 세므로, 그동안 새 읽기가 끼어들지 못한다.
+ * 기다리는 동안 RW의 모든 보유자에게 우선순위를 기부한다.
+ * 이 보유는 호출자가 넘긴 R에 기록되며, R은 rwlock_read_release()까지 유효해야 한다.
+ * 한 스레드는 같은 잠금을 두 번 읽기로 획득할 수 없다.
+ *
+ * 이 함수는 BLOCKED 될 수 있으므로 인터럽트 핸들러 내에서 호출해서는 안된다.
+ */
+void rwlock_read_acquire (struct rwlock *rw, struct rwlock_read *r) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+#ifdef LOCKSTAT
+	uint64_t wait_start;
+	bool contended;
+#endif
+
+	ASSERT (rw != NULL);
+	ASSERT (r != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->writer != t);
+	ASSERT (!rwlock_read_held_by_current_thread (rw));
+
+	old_level = intr_disable ();
+#ifdef LOCKSTAT
+	wait_start = rdtsc ();
+	contended = rw->writer != NULL || rw->writers_pending > 0;
+#endif
+	while (rw->writer != NULL || rw->writers_pending > 0)
+		rwlock_wait (rw, &rw->read_waiters);
+	t->wait_on_rwlock = NULL;
+
+	rw->readers++;
+	r->rwlock = rw;
+	r->thread = t;
+	list_push_back (&rw->read_holds, &r->elem);
+	rwlock_hold (rw, t, &r->hold);
+#ifdef LOCKSTAT
+	r->acquired = rdtsc ();
+	r->stat = lockstat_acquired (rw->name, __builtin_return_address (0),
+	                             wait_start, r->acquired, contended);
+#endif
+	intr_set_level (old_level);
+}
+
+/* rwlock_read_release - 현재 스레드가 R로 공유 모드로 보유한 RW를 해제한다.
+ * 마지막 읽기 스레드가 나가면 기다리는 쓰기 스레드 하나를 깨운다.
+ */
+void rwlock_read_release (struct rwlock *rw, struct rwlock_read *r) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (r != NULL && r->rwlock == rw && r->thread == t);
+
+	old_level = intr_disable ();
+#ifdef LOCKSTAT
+	lockstat_released (r->stat, r->acquired);
+#endif
+	list_remove (&r->elem);
+	if (!thread_mlfqs) {
+		rb_remove (&t->held_locks, &r->hold.elem);
+		donation_refresh (t);
+	}
+	if (--rw->readers == 0 && !waitq_empty (&rw->write_waiters))
+		thread_unblock (waitq_pop (&rw->write_waiters));
+	intr_set_level (old_level);
+	thread_try_yield ();
+}
+
+/* rwlock_write_acquire - RW를 배타 모드로 획득한다. 다른 보유자가 모두 나갈 때까지 기다린다.
+ * 기다리는 동안 보유 중인 쓰기 스레드나 모든 읽기 스레드에게 우선순위를 기부한다.
+ *
+ * 이 함수는 BLOCKED 될 수 있으므로 인터럽트 핸들러 내에서 호출해서는 안된다.
+ */
+void rwlock_write_acquire (struct rwlock *rw) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+#ifdef LOCKSTAT
+	uint64_t wait_start;
+	bool contended;
+#endif
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->writer != t);
+
+	old_level = intr_disable ();
+#ifdef LOCKSTAT
+	wait_start = rdtsc ();
+	contended = rw->writer != NULL || rw->readers > 0;
+#endif
+	rw->writers_pending++;
+	while (rw->writer != NULL || rw->readers > 0)
+		rwlock_wait (rw, &rw->write_waiters);
+	t->wait_on_rwlock = NULL;
+
+	rw->writers_pending--;
+	rw->writer = t;
+	rwlock_hold (rw, t, &rw->write_hold);
+#ifdef LOCKSTAT
+	rw->write_acquired = rdtsc ();
+	rw->write_stat = lockstat_acquired (rw->name, __builtin_return_address (0),
+	                                    wait_start, rw->write_acquired, contended);
+#endif
+	intr_set_level (old_level);
+}
+
+/* rwlock_write_release - 현재 스레드가 배타 모드로 보유한 RW를 해제한다.
+ * 기다리는 쓰기 스레드가 있으면 하나를 깨우고, 없으면 기다리는 읽기 스레드를 모두 깨운다.
+ * 이미 깨어난 쓰기 스레드가 남아 있다면 읽기 스레드는 그 스레드가 해제할 때 깨운다.
+ */
+void rwlock_write_release (struct rwlock *rw) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_write_held_by_current_thread (rw));
+
+	old_level = intr_disable ();
+#ifdef LOCKSTAT
+	lockstat_released (rw->write_stat, rw->write_acquired);
+#endif
+	rw->writer = NULL;
+	if (!thread_mlfqs) {
+		rb_remove (&t->held_locks, &rw->write_hold.elem);
+		donation_refresh (t);
+	}
+	if (!waitq_empty (&rw->write_waiters))
+		thread_unblock (waitq_pop (&rw->write_waiters));
+	else if (rw->writers_pending == 0)
+		while (!waitq_empty (&rw->read_waiters))
+			thread_unblock (waitq_pop (&rw->read_waiters));
+	intr_set_level (old_level);
+	thread_try_yield ();
+}
+
+/* Returns true if the current thread holds RW for writing,
+   false otherwise. */
+bool
+rwlock_write_held_by_current_thread (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return rw->writer == thread_current ();
+}
+
+/* rwlock_read_held_by_current_thread - 현재 스레드가 RW를 공유 모드로 보유하고 있다면 true를 반환한다.
+ * 읽기 스레드의 수에 비례하는 시간이 걸린다.
+ */
+bool rwlock_read_held_by_current_thread (const struct rwlock *rw) {
+	struct thread *t = thread_current ();
+	struct list *holds = (struct list *) &rw->read_holds;
+	struct list_elem *e;
+	enum intr_level old_level;
+	bool held = false;
+
+	ASSERT (rw != NULL);
+
+	old_level = intr_disable ();
+	for (e = list_begin (holds); !held && e != list_end (holds); e = list_next (e))
+		held = list_entry (e, struct rwlock_read, elem)->thread == t;
+	intr_set_level (old_level);
+	return held;
+}
+
+/* rwlock_wait - 현재 스레드를 RW의 대기 큐 Q에 넣고 BLOCKED 상태로 전환한다.
+ * 잠들기 전에 RW의 보유자들에게 우선순위를 기부한다.
+ */
+static void rwlock_wait (struct rwlock *rw, struct waitq *q) {
+	struct thread *t = thread_current ();
+
+	waitq_push (q, &t->wait_elem, t);
+	if (!thread_mlfqs) {
+		t->wait_on_rwlock = rw;
+		rwlock_propagate (rw, 1);
+	}
+	thread_block ();
+}
+
+/* rwlock_hold - RW를 새로 보유한 스레드 T의 HOLD를 held_locks에 넣는다.
+ * 기존 보유자들의 기부도 지금 기다리는 스레드들 기준으로 다시 맞춘 뒤 T의 우선순위를 다시 계산한다.
+ */
+static void rwlock_hold (struct rwlock *rw, struct thread *t, struct lock_hold *hold) {
+	if (thread_mlfqs)
+		return;
+	hold->donation = rw->donation;
+	rb_insert (&t->held_locks, &hold->elem);
+	rwlock_propagate (rw, 1);
+	donation_refresh (t);
+}
+
+/* rwlock_propagate - RW를 기다리는 스레드 중 가장 높은 우선순위를 보유 중인 쓰기 스레드나 모든 읽기 스레드에게 기부한다.
+ * 기부가 바뀌지 않았다면 아무것도 하지 않는다. DEPTH는 지금까지 거쳐온 잠금의 개수이다.
+ */
+static void rwlock_propagate (struct rwlock *rw, int depth) {
+	int donation = MAX (waitq_max_priority (&rw->read_waiters),
+	                    waitq_max_priority (&rw->write_waiters));
+	struct list_elem *e;
+
+	if (donation == rw->donation)
+		return;
+	rw->donation = donation;
+	if (rw->writer != NULL)
+		donation_hold_set (rw->writer, &rw->write_hold, donation, depth);
+	for (e = list_begin (&rw->read_holds); e != list_end (&rw->read_holds); e = list_next (e)) {
+		struct rwlock_read *r = list_entry (e, struct rwlock_read, elem);
+
+		donation_hold_set (r->thread, &r->hold, donation, depth);
+	}
+}
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
@@ -297,7 +825,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	waitq_init (&cond->waiters);
 }
 
 /* cond_wait - 잠금을 원자적으로 해제하고 다른 코드가 COND 신호를 보낼 때까지 기다린다.
@@ -315,37 +843,49 @@ cond_init (struct condition *cond) {
  * 이 함수는 인터럽트가 비활성화된 상태에서 호출될 수 있지만, Sleep이 필요하면 인터럽트가 다시 활성화된다.
  */
 void cond_wait (struct condition *cond, struct lock *lock) {
-	struct semaphore_elem waiter;
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	sema_init (&waiter.semaphore, 0);
-	list_insert_ordered(&cond->waiters, &waiter.elem, (list_less_func *)&cond_priority, NULL);
+	old_level = intr_disable ();
+	waitq_push (&cond->waiters, &t->wait_elem, t);
 	lock_release (lock);
-	sema_down (&waiter.semaphore);
+	while (t->wait_elem.queue == &cond->waiters)
+		thread_block ();
+	intr_set_level (old_level);
 	lock_acquire (lock);
 }
 
 /* cond_signal - COND에 대기 중인 스레드 중 하나에게 신호를 보낸다.
  * 신호를 받은 스레드는 대기를 해제하고, 신호를 보낸 스레드가 잠금을 유지하고 있는 경우 잠금을 다시 획득한다.
+ * waiters에서 가장 높은 우선순위의 스레드를 O(1)에 꺼낸다. 그 스레드가 lock_release()에서 양보하느라
+ * 아직 BLOCKED가 되지 않았다면, 큐에서 빠진 것을 보고 잠들지 않고 돌아간다.
  * 
  * 이 함수는 LOCK이 유지되어야 한다.
  * 
  * 인터럽트 핸들러는 잠금을 획득할 수 없으므로 인터럽트 핸들러 내에서 조건 변수를 신호로 보내는 것은 의미가 없다.
  */
 void cond_signal (struct condition *cond, struct lock *lock UNUSED) {
+	enum intr_level old_level;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters)) {
-		list_sort(&cond->waiters, (list_less_func *)&cond_priority, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters), struct semaphore_elem, elem)->semaphore);
+	old_level = intr_disable ();
+	if (!waitq_empty (&cond->waiters)) {
+		struct thread *t = waitq_pop (&cond->waiters);
+
+		if (t->status == THREAD_BLOCKED)
+			thread_unblock (t);
 	}
+	intr_set_level (old_level);
+	thread_try_yield ();
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -355,19 +895,20 @@ void cond_signal (struct condition *cond, struct lock *lock UNUSED) {
    make sense to try to signal a condition variable within an
    interrupt handler. */
 void cond_broadcast (struct condition *cond, struct lock *lock) {
+	enum intr_level old_level;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (lock_held_by_current_thread (lock));
 
-	while (!list_empty (&cond->waiters))
-		cond_signal (cond, lock);
-}
+	old_level = intr_disable ();
+	while (!waitq_empty (&cond->waiters)) {
+		struct thread *t = waitq_pop (&cond->waiters);
 
-/* cond_priority - 조건 변수의 대기자 리스트에서 우선순위가 높은 스레드를 찾는다.
- */
-bool cond_priority(const struct list_elem *a, const struct list_elem  *b, void *aux UNUSED) {
-    struct semaphore_elem *sema_a = list_entry(a, struct semaphore_elem, elem);
-    struct semaphore_elem *sema_b = list_entry(b, struct semaphore_elem, elem);
-    struct thread *t_a = list_entry(list_begin(&sema_a->semaphore.waiters), struct thread, elem);
-    struct thread *t_b = list_entry(list_begin(&sema_b->semaphore.waiters), struct thread, elem);
-    return t_a->priority > t_b->priority;
-}
\ No newline at end of file
+		if (t->status == THREAD_BLOCKED)
+			thread_unblock (t);
+	}
+	intr_set_level (old_level);
+	thread_try_yield ();
+}
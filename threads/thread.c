@@ -2,13 +2,16 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <rbtree.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "threads/fixed-point.h"
 #include "intrinsic.h"
@@ -25,15 +28,23 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* THREAD_READY 상태의 스레드 리스트, 즉 실행할 준비가 되었지만 실제로 실행되지는 않은 스레드의 리스트
- * priority를 기준으로 내림차순 정렬되어 있다.
+/* THREAD_READY 상태의 스레드 큐, 즉 실행할 준비가 되었지만 실제로 실행되지는 않은 스레드들이다.
+ * 우선순위마다 하나의 FIFO 큐를 두고, mask의 i번째 비트는 queues[i]가 비어있지 않음을 뜻한다.
+ * 따라서 삽입/삭제는 O(1)이고, 가장 높은 우선순위는 비트 스캔 한 번으로 찾는다.
+ * 런큐는 인터럽트를 끈 상태에서만 접근한다.
  */
-static struct list ready_list;
-
-/* THREAD_BLOCKED 상태의 스레드 리스트, 즉 실행할 준비가 되지 않은 스레드의 리스트
- * wakeup_tick을 기준으로 오름차순 정렬되어 있다.
- */
-static struct list sleep_list;
+struct runqueue {
+	struct list queues[PRI_MAX + 1];
+	uint64_t mask;
+	size_t cnt; /* 런큐에 들어있는 스레드의 수 */
+	size_t background_cnt; /* 그중 백그라운드 스레드의 수 */
+
+	/* -cfs: vruntime 순으로 정렬된 READY 스레드와 그 가중치의 합 */
+	struct rbtree cfs_tree;
+	uint64_t min_vruntime; /* 단조 증가하는 vruntime의 하한 */
+	unsigned long cfs_load;
+};
+static struct runqueue ready_rq;
 
 /* RUNNING, READY, BLOCKED 상태의 모든 스레드 리스트
  * IDLE 스레드는 포함하지 않는다.
@@ -55,15 +66,58 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* reaper_thread는 destruction_req에 쌓인 종료된 스레드의 페이지를 회수하는 스레드이다.
+ * 백그라운드 스레드이므로 -mlfqs에서도 우선순위는 PRI_MIN이며, 회수할 스레드가 없으면 BLOCKED 상태로 기다린다.
+ * 다른 스레드가 계속 실행 중이면 reaper는 실행되지 못하므로, thread_page_get()도 직접 회수한다.
+ */
+static struct thread *reaper_thread;
+
+/* 회수된 스레드 페이지의 캐시.
+ * thread_create()는 여기서 페이지를 재사용하고 struct thread 헤더만 초기화한다.
+ * 스택 영역은 0으로 채울 필요가 없으므로 4 kB 전체를 지우는 비용이 들지 않는다.
+ */
+#define THREAD_CACHE_MAX 32
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+
 /* Statistics. */
 static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
 static long long user_ticks;   /* # of timer ticks in user programs. */
 
+/* sched_total - 종료된 스레드를 포함한 모든 스레드의 스케줄러 통계 합계.
+ */
+static struct schedstat sched_total;
+
 /* Scheduling. */
 #define TIME_SLICE 4		  /* # of timer ticks to give each thread. */
 static unsigned thread_ticks; /* # of timer ticks since last yield. */
 
+/* -cfs 스케줄링.
+ * 모든 READY 스레드가 CFS_LATENCY tick 안에 한 번씩 실행되도록, 각 스레드는 가중치에 비례하는 slice를 받는다.
+ * slice는 CFS_MIN_GRANULARITY tick보다 짧아지지 않는다.
+ */
+#define CFS_LATENCY 8		  /* Target latency, in timer ticks. */
+#define CFS_MIN_GRANULARITY 1 /* Minimum slice, in timer ticks. */
+#define NICE_0_WEIGHT 1024	  /* Weight of a thread with nice 0. */
+
+/* nice 값 -20 ~ 20에 해당하는 가중치. nice가 1 낮아질 때마다 CPU 몫이 약 1.25배가 된다. */
+static const int nice_to_weight[NICE_MAX - NICE_MIN + 1] = {
+	/* -20 */ 88761, 71755, 56483, 46273, 36291,
+	/* -15 */ 29154, 23254, 18705, 14949, 11916,
+	/* -10 */ 9548, 7620, 6100, 4904, 3906,
+	/*  -5 */ 3121, 2501, 1991, 1586, 1277,
+	/*   0 */ 1024, 820, 655, 526, 423,
+	/*   5 */ 335, 272, 215, 172, 137,
+	/*  10 */ 110, 87, 70, 56, 45,
+	/*  15 */ 36, 29, 23, 18, 15,
+	/*  20 */ 12,
+};
+
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
@@ -76,15 +130,33 @@ bool thread_mlfqs;
  */
 int load_avg;
 
+/* MLFQS 부가 정보.
+ * mlfqs_seconds는 부팅 이후 load_avg가 갱신된 횟수(초)이고, decay_history는 최근 DECAY_HISTORY초 동안의 decay 값이다.
+ * BLOCKED 스레드는 매 초 갱신되지 않고, 깨어날 때 자신의 mlfqs_epoch 이후의 decay를 한꺼번에 적용받는다.
+ */
+#define DECAY_HISTORY 1024
+static int64_t mlfqs_seconds;
+static int decay_history[DECAY_HISTORY];
+
 
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
+static void reaper(void *aux UNUSED);
+static void reap_dead_threads(void);
+static struct thread *thread_page_get(void);
+static void thread_page_put(struct thread *);
 static struct thread *next_thread_to_run(void);
 static void init_thread(struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
+static void runqueue_init(struct runqueue *);
+static void ready_queue_push(struct thread *);
+static struct thread *ready_queue_pop(void);
+static void ready_queue_remove(struct thread *);
+static void ready_queue_drain(struct list *);
+static int ready_queue_max_priority(void);
 
 void calculate_load_avg(void);
 void calculate_all_recent_cpu(void);
@@ -92,6 +164,14 @@ int calculate_one_recent_cpu(struct thread *t);
 void recent_cpu_plus(void);
 void calculate_all_priority(void);
 int calculate_one_priority(struct thread *t);
+static void mlfqs_catch_up(struct thread *t);
+static void mlfqs_decay(struct thread *t);
+static void schedstat_charge(struct thread *t, enum thread_status status, uint64_t now);
+static bool cfs_less(const struct rb_elem *a, const struct rb_elem *b, void *aux);
+static void cfs_update_curr(struct thread *t, uint64_t now);
+static unsigned cfs_slice(struct thread *t);
+static bool cfs_should_preempt(struct thread *t);
+static void thread_wakeup(void *t_);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -137,10 +217,10 @@ void thread_init(void)
 
 	/* Init the globla thread context */
 	lock_init(&tid_lock);
-	list_init(&ready_list);
-	list_init(&sleep_list);
+	runqueue_init(&ready_rq);
 	list_init(&all_list);
 	list_init(&destruction_req);
+	list_init(&thread_cache);
 	load_avg = 0;
 
 	/* Set up a thread structure for the running thread. */
@@ -158,6 +238,7 @@ void thread_start(void)
 	struct semaphore idle_started;
 	sema_init(&idle_started, 0);
 	thread_create("idle", PRI_MIN, idle, &idle_started);
+	thread_create("reaper", PRI_MIN, reaper, NULL);
 
 	/* Start preemptive thread scheduling. */
 	intr_enable();
@@ -183,8 +264,21 @@ void thread_tick(void)
 	else
 		kernel_ticks++;
 
-	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	/* Enforce preemption.  The idle thread gives up the CPU on
+	   its own, and may account ticks outside interrupt context
+	   when catching up after a tickless idle period. */
+	if (t == idle_thread)
+		return;
+	thread_ticks++;
+	if (thread_cfs)
+	{
+		/* Give up the CPU once our slice is used up, unless we
+		   are still the thread that has run the least. */
+		cfs_update_curr(t, rdtsc());
+		if (thread_ticks >= cfs_slice(t) && cfs_should_preempt(t))
+			intr_yield_on_return();
+	}
+	else if (thread_ticks >= TIME_SLICE)
 		intr_yield_on_return();
 }
 
@@ -195,9 +289,73 @@ void thread_print_stats(void)
 		   idle_ticks, kernel_ticks, user_ticks);
 }
 
+/* thread_print_schedstat - 스케줄러 통계를 출력한다.
+ * 전체 합계와 ready-to-run 지연 시간 히스토그램, 그리고 살아있는 스레드별 합계를 출력한다.
+ */
+void thread_print_schedstat(void)
+{
+	struct list_elem *e;
+	int i;
+
+	printf("Scheduler: %llu voluntary, %llu involuntary switches\n",
+		   sched_total.voluntary_switches, sched_total.involuntary_switches);
+	printf("Scheduler: %llu ready, %llu running, %llu blocked ns\n",
+		   timer_cycles_to_ns(sched_total.ready_cycles), timer_cycles_to_ns(sched_total.run_cycles),
+		   timer_cycles_to_ns(sched_total.blocked_cycles));
+	printf("Scheduler: ready-to-run latency (cycles):\n");
+	for (i = 0; i < SCHEDSTAT_BUCKETS; i++)
+		if (sched_total.latency[i] != 0)
+			printf("  2^%-2d %10u\n", i + SCHEDSTAT_SHIFT, sched_total.latency[i]);
+
+	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+	{
+		struct thread *t = list_entry(e, struct thread, a_elem);
+		printf("  tid %d (%s): %llu ready, %llu running, %llu blocked ns, %llu/%llu switches\n",
+			   t->tid, t->name, timer_cycles_to_ns(t->stat.ready_cycles), timer_cycles_to_ns(t->stat.run_cycles),
+			   timer_cycles_to_ns(t->stat.blocked_cycles),
+			   t->stat.voluntary_switches, t->stat.involuntary_switches);
+	}
+}
+
+/* thread_get_schedstat - tid가 TID인 스레드의 스케줄러 통계를 STAT에 복사한다.
+ * TID가 0이면 종료된 스레드를 포함한 전체 합계를 복사한다.
+ * 진행 중인 상태의 시간도 포함한다. 해당 스레드가 없으면 false를 반환한다.
+ */
+bool thread_get_schedstat(tid_t tid, struct schedstat *stat)
+{
+	enum intr_level old_level = intr_disable();
+	struct list_elem *e;
+	bool found = false;
+
+	if (tid == 0)
+	{
+		*stat = sched_total;
+		found = true;
+	}
+	for (e = list_begin(&all_list); !found && e != list_end(&all_list); e = list_next(e))
+	{
+		struct thread *t = list_entry(e, struct thread, a_elem);
+		if (t->tid == tid)
+		{
+			uint64_t delta = rdtsc() - t->stat_since;
+
+			*stat = t->stat;
+			if (t->status == THREAD_RUNNING)
+				stat->run_cycles += delta;
+			else if (t->status == THREAD_READY)
+				stat->ready_cycles += delta;
+			else
+				stat->blocked_cycles += delta;
+			found = true;
+		}
+	}
+	intr_set_level(old_level);
+	return found;
+}
+
 /* 새로운 커널 스레드를 생성한다. NAME은 스레드의 이름이며, PRIORITY는 스레드의 우선순위이다.
  * FUNCTION은 스레드가 실행할 함수이며, AUX는 FUNCTION에 전달할 인자이다.
- * 스레드를 생성하고, ready_list에 스레드를 추가한다.
+ * 스레드를 생성하고, ready 큐에 스레드를 추가한다.
  * 새 스레드의 tid를 반환하거나 생성에 실패하면 TID_ERROR를 반환한다.
  * FUNCTION이 실행되는 시점은 thread_create()가 반환된 이후이다.
  * 새로 생성된 스레드와 현재 실행 중인 스레드의 우선 순위를 비교하여 현재 스레드의 우선 순위가 더 낮다면 CPU를 양보한다.
@@ -211,18 +369,29 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 {
 	enum intr_level old_level;
 	struct thread *t;
+	struct file **fdt;
 	tid_t tid;
 
 	ASSERT(function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page(PAL_ZERO);
+	t = thread_page_get();
 	if (t == NULL)
 		return TID_ERROR;
 
+	/* init_thread()가 t를 all_list에 넣으므로, 실패할 수 있는 할당은 그 전에 끝낸다. */
+	//t->fdt = palloc_get_multiple(PAL_ZERO | PAL_ASSERT, FDT_PAGES);
+	fdt = (struct file **)palloc_get_multiple(PAL_ZERO, FDT_PAGES);
+	if (fdt == NULL)
+	{
+		thread_page_put(t);
+		return TID_ERROR;
+	}
+
 	/* Initialize thread. */
 	init_thread(t, name, priority);
 	tid = t->tid = allocate_tid();
+	t->fdt = fdt;
 
 
 	/* Call the kernel_thread if it scheduled.
@@ -236,13 +405,6 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 	t->tf.cs = SEL_KCSEG;
 	t->tf.eflags = FLAG_IF;
 
-	//t->fdt = palloc_get_multiple(PAL_ZERO | PAL_ASSERT, FDT_PAGES);
-	t->fdt = (struct file **)palloc_get_multiple(PAL_ZERO, FDT_PAGES);
-	if (t->fdt == NULL)
-	{
-		palloc_free_page(t);
-		return TID_ERROR;
-	}
 	// fdt 배열을 동적으로 할당
 	//struct file** fdt = (struct file**)malloc(FDT_SIZE * sizeof(struct file*));
 
@@ -260,7 +422,9 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 	thread_unblock(t);
 
 	old_level = intr_disable();
-	if (thread_get_priority() < priority)
+	if (thread_cfs)
+		thread_try_yield();
+	else if (thread_get_priority() < priority)
 		thread_yield();
 
 	intr_set_level(old_level);
@@ -280,7 +444,7 @@ void thread_block(void)
 	schedule();
 }
 
-/* thread_unblock - BLOCKED 스레드 t를 READY 상태로 전환하고 ready_list에 우선순위 내림차순으로 삽입한다.
+/* thread_unblock - BLOCKED 스레드 t를 READY 상태로 전환하고 t의 우선순위에 해당하는 ready 큐의 끝에 삽입한다.
  * t가 BLOCKED 상태가 아니라면 에러이다. (running thread를 READY 상태로 전환하려면 thread_yield()를 사용하라)
  * 이 함수는 현재 실행중인 스레드를 선점하지 않는다. 이것은 중요할 수 있다.
  * 만약 호출자가 직접 인터럽트를 비활성화했다면, 스레드를 unblock하고 다른 데이터를 업데이트할 수 있다고 기대할 수 있다.
@@ -292,7 +456,9 @@ void thread_unblock(struct thread *t)
 	ASSERT(t->status == THREAD_BLOCKED);
 
 	old_level = intr_disable();
-	list_insert_ordered(&ready_list, &t->elem, (list_less_func *)higher_priority, NULL);
+	schedstat_charge(t, THREAD_BLOCKED, rdtsc());
+	mlfqs_catch_up(t);
+	ready_queue_push(t);
 	t->status = THREAD_READY;
 	intr_set_level(old_level);
 }
@@ -336,6 +502,7 @@ void thread_exit(void)
 #ifdef USERPROG
 	process_exit();
 #endif
+	malloc_thread_exit();
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
@@ -344,9 +511,9 @@ void thread_exit(void)
 	NOT_REACHED();
 }
 
-/* thread_yield - 현재 실행 중인 스레드가 CPU를 양보하고, ready_list에 우선순위 내림차순으로 삽입한다.
+/* thread_yield - 현재 실행 중인 스레드가 CPU를 양보하고, 자신의 우선순위에 해당하는 ready 큐의 끝에 삽입된다.
  * 현재 스레드는 BLOCKED 상태로 전환되지 않으며 스케줄러의 재량에 따라 즉시 다시 스케줄될 수 있다.
- * 만약 현재 스레드가 Idle 스레드라면 ready_list에 삽입하지 않는다.
+ * 만약 현재 스레드가 Idle 스레드라면 ready 큐에 삽입하지 않는다.
  */
 void thread_yield(void)
 {
@@ -357,31 +524,88 @@ void thread_yield(void)
 
 	old_level = intr_disable();
 	if (curr != idle_thread)
-		list_insert_ordered(&ready_list, &curr->elem, (list_less_func *)higher_priority, NULL);
+		ready_queue_push(curr);
 	do_schedule(THREAD_READY);
 	intr_set_level(old_level);
 }
 
+/* thread_try_yield - ready 큐에 현재 스레드보다 우선순위가 높은 스레드가 있다면 CPU를 양보한다.
+ * -cfs에서는 현재 스레드가 최소 slice만큼 실행했고, ready 큐에 vruntime이 더 작은 스레드가 있다면 양보한다.
+ * 인터럽트 핸들러에서 호출되면 핸들러가 반환될 때 양보한다.
+ */
 void thread_try_yield(void) {
-	if (!list_empty(&ready_list) && thread_current() != idle_thread) {
-		if (list_entry(list_front(&ready_list), struct thread, elem)->priority > thread_current()->priority) {
-			thread_yield();
+	struct thread *curr = thread_current();
+
+	if (thread_cfs) {
+		enum intr_level old_level;
+		bool preempt;
+
+		if (curr == idle_thread || thread_ticks < CFS_MIN_GRANULARITY)
+			return;
+		old_level = intr_disable();
+		cfs_update_curr(curr, rdtsc());
+		preempt = cfs_should_preempt(curr);
+		intr_set_level(old_level);
+
+		if (preempt) {
+			if (intr_context())
+				intr_yield_on_return();
+			else
+				thread_yield();
 		}
+		return;
 	}
+
+	if (ready_rq.cnt != 0 && curr != idle_thread && ready_queue_max_priority() > curr->priority) {
+		if (intr_context())
+			intr_yield_on_return();
+		else
+			thread_yield();
+	}
+}
+
+/* thread_update_priority - 스레드 t의 우선순위를 priority로 바꾼다.
+ * t가 READY 상태라면 새 우선순위에 해당하는 ready 큐로 옮겨서, 기부 등으로 우선순위가 바뀐 스레드도
+ * 올바른 순서로 스케줄되도록 한다. t가 세마포어나 조건 변수를 기다리고 있다면 waiters에서도 새 우선순위 칸으로 옮긴다.
+ * 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+void thread_update_priority(struct thread *t, int priority)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+	if (t->priority == priority)
+		return;
+	if (t->status == THREAD_READY && t != idle_thread)
+	{
+		ready_queue_remove(t);
+		t->priority = priority;
+		ready_queue_push(t);
+	}
+	else
+		t->priority = priority;
+	if (t->wait_elem.queue != NULL)
+		waitq_update(&t->wait_elem);
 }
 
 /* thread_set_priority - 현재 스레드의 우선순위를 새로운 우선순위로 설정하고,
- * 우선순위가 낮아진다면 ready_list에서 자신보다 더 높은 우선순위를 가진 스레드가 있는지 확인하여야 한다.
+ * 우선순위가 낮아진다면 ready 큐에 자신보다 더 높은 우선순위를 가진 스레드가 있는지 확인하여야 한다.
+ * 기부받은 우선순위가 더 높다면 잠금을 해제할 때까지 그 우선순위를 유지한다.
  * 고급 스케줄러를 사용하는 경우에는 이 함수를 사용하지 않는다.
  */
 void thread_set_priority(int new_priority)
 {
-	thread_current()->original_priority = new_priority;
-	if (list_empty(&thread_current()->donations))
-	{
-		thread_current()->priority = new_priority;
-	}
-	if (!list_empty(&ready_list) && list_entry(list_front(&ready_list), struct thread, elem)->priority > new_priority)
+	struct thread *curr = thread_current();
+	enum intr_level old_level = intr_disable();
+
+	curr->original_priority = new_priority;
+	if (thread_mlfqs)
+		curr->priority = new_priority;
+	else
+		donation_refresh(curr);
+	intr_set_level(old_level);
+
+	if (ready_rq.cnt != 0 && ready_queue_max_priority() > curr->priority)
 		thread_yield();
 }
 
@@ -398,10 +622,33 @@ int thread_get_priority(void)
 void thread_set_nice(int nice)
 {
 	struct thread *t = thread_current();
+
+	if (thread_cfs)
+	{
+		/* 지금까지 실행한 시간은 이전 가중치로 계산한다. */
+		enum intr_level old_level = intr_disable();
+		cfs_update_curr(t, rdtsc());
+		t->nice = nice;
+		intr_set_level(old_level);
+		thread_try_yield();
+		return;
+	}
 	t->nice = nice;
 	thread_set_priority(calculate_one_priority(t));
 }
 
+/* thread_set_background - 현재 스레드를 백그라운드 스레드로 만든다.
+ * 백그라운드 스레드는 다른 스레드가 없을 때만 실행되는 커널 작업 스레드이다.
+ * nice는 NICE_MAX가 되고, -mlfqs에서도 우선순위가 PRI_MIN에 머물며, load_avg의 ready_threads에 세지 않는다.
+ */
+void thread_set_background(void)
+{
+	enum intr_level old_level = intr_disable();
+	thread_current()->background = true;
+	intr_set_level(old_level);
+	thread_set_nice(NICE_MAX);
+}
+
 /* thread_get_nice - 현재 스레드의 nice 값을 반환한다.
  */
 int thread_get_nice(void)
@@ -409,6 +656,16 @@ int thread_get_nice(void)
 	return thread_current()->nice;
 }
 
+/* thread_nice_weight - nice 값이 NICE인 스레드의 -cfs 가중치를 반환한다.
+ * 범위를 벗어난 nice 값은 NICE_MIN ~ NICE_MAX로 제한한다.
+ */
+int thread_nice_weight(int nice)
+{
+	nice = MAX(nice, NICE_MIN);
+	nice = MIN(nice, NICE_MAX);
+	return nice_to_weight[nice - NICE_MIN];
+}
+
 /* thread_get_load_avg - 시스템의 load_avg * 100을 반환한다.
  */
 int thread_get_load_avg(void)
@@ -423,46 +680,97 @@ int thread_get_recent_cpu(void)
 	return convert_to_integer_towards_zero(multiply_fixed_point_integer(thread_current()->recent_cpu, 100));
 }
 
-/* calculate_load_avg - load_avg를 1초마다 계산한다.
+/* calculate_load_avg - load_avg를 1초마다 계산하고, 이번 1초 동안 사용할 decay를 미리 구해둔다.
  * load_avg = (59/60)*load_avg + (1/60)*ready_threads
+ * decay = (2 * load_avg) / (2 * load_avg + 1)
+ * ready_threads는 런큐가 유지하는 cnt를 그대로 사용하므로 O(1)이다. 백그라운드 스레드는 세지 않는다.
  */
 void calculate_load_avg(void)
 {
-	int ready_threads = list_size(&ready_list);
-	if (thread_current() != idle_thread)
+	struct thread *curr = thread_current();
+	int ready_threads = ready_rq.cnt - ready_rq.background_cnt;
+	if (curr != idle_thread && !curr->background)
 		ready_threads++;
 	load_avg = multiply_fixed_point((59 * F) / 60, load_avg) + (((1 * F) / 60) * ready_threads);
+
+	mlfqs_seconds++;
+	decay_history[mlfqs_seconds % DECAY_HISTORY] =
+		divide_fixed_point(multiply_fixed_point_integer(load_avg, 2), add_fixed_point_integer(multiply_fixed_point_integer(load_avg, 2), 1));
 }
 
-/* calculate_all_recent_cpu - 모든 스레드의 recent_cpu를 1초마다 계산한다.
+/* calculate_all_recent_cpu - 실행 중인 스레드와 ready 큐의 스레드의 recent_cpu를 1초마다 계산한다.
+ * BLOCKED 스레드는 건너뛰고, 깨어날 때 mlfqs_catch_up()에서 밀린 decay를 한꺼번에 적용한다.
+ * 따라서 인터럽트 핸들러의 비용은 잠든 스레드의 수와 무관하다.
+ * ready 큐의 스레드는 모두 꺼낸 뒤 새 priority의 큐에 다시 넣으므로, 같은 tick에 calculate_all_priority()가
+ * 실행되는지와 무관하게 각 스레드는 항상 자신의 priority에 해당하는 큐에 있다.
  */
 void calculate_all_recent_cpu(void)
 {
-	if (list_empty(&all_list))
-		return;
+	struct thread *curr = thread_current();
+	struct list ready;
 
-	struct list_elem *e;
-	struct thread *t;
-	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+	if (curr != idle_thread)
+		mlfqs_decay(curr);
+
+	ready_queue_drain(&ready);
+	while (!list_empty(&ready))
 	{
-		t = list_entry(e, struct thread, a_elem);
-		t->recent_cpu = calculate_one_recent_cpu(t);
-		t->priority = calculate_one_priority(t);
+		struct thread *t = list_entry(list_pop_front(&ready), struct thread, elem);
+		mlfqs_decay(t);
+		ready_queue_push(t);
 	}
 }
 
-/* calculate_one_recent_cpu - 스레드 t의 recent_cpu를 계산한다.
- * decay = (2 * load_avg) / (2 * load_avg + 1)
+/* calculate_one_recent_cpu - 스레드 t의 recent_cpu에 이번 1초의 decay를 적용한 값을 계산한다.
  * recent_cpu = decay * recent_cpu + nice
  */
 int calculate_one_recent_cpu(struct thread *t)
 {
-	int decay = divide_fixed_point(multiply_fixed_point_integer(load_avg, 2), add_fixed_point_integer(multiply_fixed_point_integer(load_avg, 2), 1));
+	int decay = decay_history[mlfqs_seconds % DECAY_HISTORY];
 	int _recent_cpu = add_fixed_point_integer(multiply_fixed_point(decay, t->recent_cpu), t->nice);
 	return _recent_cpu;
 }
 
-/* recent_cpu_plus - 현재 스레드의 recent_cpu를 1초마다 1 증가시킨다.
+/* mlfqs_catch_up - 스레드 t가 마지막으로 갱신된 이후 지나간 매 초의 decay를 적용하고 priority를 다시 계산한다.
+ * t가 READY 상태라면 새 priority에 해당하는 ready 큐로 옮긴다.
+ * 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+static void mlfqs_catch_up(struct thread *t)
+{
+	if (t->status == THREAD_READY)
+	{
+		ready_queue_remove(t);
+		mlfqs_decay(t);
+		ready_queue_push(t);
+	}
+	else
+		mlfqs_decay(t);
+}
+
+/* mlfqs_decay - 스레드 t가 마지막으로 갱신된 이후 지나간 매 초의 decay를 순서대로 적용하고 priority를 다시 계산한다.
+ * decay_history에 남아있지 않은 오래된 초는 건너뛴다. DECAY_HISTORY번의 decay가 적용되면
+ * recent_cpu는 이미 충분히 수렴하므로 결과에 거의 영향이 없다.
+ * t는 ready 큐에 들어있으면 안 된다. 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+static void mlfqs_decay(struct thread *t)
+{
+	int64_t sec;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (!thread_mlfqs || t->mlfqs_epoch == mlfqs_seconds)
+		return;
+
+	sec = t->mlfqs_epoch + 1;
+	if (mlfqs_seconds - sec >= DECAY_HISTORY)
+		sec = mlfqs_seconds - DECAY_HISTORY + 1;
+	for (; sec <= mlfqs_seconds; sec++)
+		t->recent_cpu = add_fixed_point_integer(multiply_fixed_point(decay_history[sec % DECAY_HISTORY], t->recent_cpu), t->nice);
+	t->mlfqs_epoch = mlfqs_seconds;
+	t->priority = calculate_one_priority(t);
+}
+
+/* recent_cpu_plus - 현재 스레드의 recent_cpu를 매 tick마다 1 증가시킨다.
  */
 void recent_cpu_plus(void)
 {
@@ -474,26 +782,37 @@ void recent_cpu_plus(void)
 	}
 }
 
-/* calculate_all_priority - 모든 스레드의 priority를 4 ticks마다 계산한다.
+/* calculate_all_priority - 실행 중인 스레드와 ready 큐의 스레드의 priority를 4 ticks마다 계산한다.
+ * ready 큐의 스레드를 모두 꺼낸 뒤 새 priority로 다시 넣으므로 O(ready 스레드 수)이다.
+ * 실행 중인 스레드보다 우선순위가 높은 스레드가 생기면 인터럽트 반환 시 양보한다.
  */
 void calculate_all_priority(void) 
 {
-	if (list_empty(&all_list))
-		return;
-
-	struct list_elem *e;
-	struct thread *t;
+	struct thread *curr = thread_current();
+	struct list ready;
 
-	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+	ready_queue_drain(&ready);
+	while (!list_empty(&ready))
 	{
-		t = list_entry(e, struct thread, a_elem);
+		struct thread *t = list_entry(list_pop_front(&ready), struct thread, elem);
 		t->priority = calculate_one_priority(t);
+		ready_queue_push(t);
+	}
+
+	if (curr != idle_thread)
+	{
+		curr->priority = calculate_one_priority(curr);
+		if (ready_queue_max_priority() > curr->priority)
+			intr_yield_on_return();
 	}
 }
-/* calculate_one_priority - 스레드 t의 priority를 계산한다.
+/* calculate_one_priority - 스레드 t의 priority를 계산한다. 백그라운드 스레드는 항상 PRI_MIN이다.
  */
 int calculate_one_priority(struct thread *t)
 {
+	if (t->background)
+		return PRI_MIN;
+
 	int priority = PRI_MAX - convert_to_integer_towards_zero(t->recent_cpu / 4) - (t->nice * 2);
 	priority = MAX(priority, PRI_MIN);
 	priority = MIN(priority, PRI_MAX);
@@ -520,8 +839,23 @@ static void idle(void *idle_started_ UNUSED)
 	{
 		/* Let someone else run. */
 		intr_disable();
+		timer_idle_exit();
 		thread_block();
 
+		/* schedule() may have readied a thread (the reaper) while
+		   switching to us.  Run it instead of halting. */
+		if (ready_rq.cnt != 0)
+			continue;
+
+		/* Spend the idle time zeroing a free page, then look for
+		   work again. */
+		if (palloc_idle_zero())
+			continue;
+
+		/* Nothing else to run.  With -tickless, stop the periodic
+		   tick until the earliest sleeper's deadline. */
+		timer_idle_enter();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -534,10 +868,91 @@ static void idle(void *idle_started_ UNUSED)
 
 		   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
 		   7.11.1 "HLT Instruction". */
+		intr_irqsoff_stop();
 		asm volatile("sti; hlt" : : : "memory");
 	}
 }
 
+/* reaper - 종료된 스레드의 페이지를 회수하는 스레드.
+ * destruction_req가 빌 때까지 BLOCKED 상태로 기다리다가, schedule()이 깨우면 reap_dead_threads()로 회수한다.
+ */
+static void reaper(void *aux UNUSED)
+{
+	reaper_thread = thread_current();
+	thread_set_background();
+
+	for (;;)
+	{
+		enum intr_level old_level = intr_disable();
+		while (list_empty(&destruction_req))
+			thread_block();
+		intr_set_level(old_level);
+
+		reap_dead_threads();
+	}
+}
+
+/* reap_dead_threads - destruction_req에 쌓인 종료된 스레드를 한 번에 떼어내어
+ * 인터럽트가 켜진 상태에서 thread_page_put()으로 돌려준다.
+ */
+static void reap_dead_threads(void)
+{
+	struct list dead;
+	enum intr_level old_level;
+
+	list_init(&dead);
+	old_level = intr_disable();
+	list_splice(list_end(&dead), list_begin(&destruction_req), list_end(&destruction_req));
+	intr_set_level(old_level);
+
+	while (!list_empty(&dead))
+		thread_page_put(list_entry(list_pop_front(&dead), struct thread, elem));
+}
+
+/* thread_page_get - 새 스레드를 위한 페이지를 반환한다.
+ * 먼저 종료된 스레드를 회수하여 캐시에 넣으므로, reaper가 실행될 기회가 없어도 페이지가 재사용된다.
+ * 캐시에 회수된 페이지가 있다면 재사용하고, 없다면 palloc으로 새 페이지를 할당한다.
+ * struct thread 헤더는 init_thread()가 초기화하므로 페이지를 0으로 채우지 않는다.
+ */
+static struct thread *thread_page_get(void)
+{
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	reap_dead_threads();
+
+	old_level = intr_disable();
+	if (!list_empty(&thread_cache))
+	{
+		t = list_entry(list_pop_front(&thread_cache), struct thread, elem);
+		thread_cache_cnt--;
+	}
+	intr_set_level(old_level);
+
+	if (t == NULL)
+		t = palloc_get_page(0);
+	return t;
+}
+
+/* thread_page_put - 더 이상 사용하지 않는 스레드 페이지 T를 캐시에 넣는다.
+ * 캐시가 가득 찼다면 palloc에 반환한다.
+ */
+static void thread_page_put(struct thread *t)
+{
+	enum intr_level old_level = intr_disable();
+
+	if (thread_cache_cnt < THREAD_CACHE_MAX)
+	{
+		list_push_front(&thread_cache, &t->elem);
+		thread_cache_cnt++;
+		t = NULL;
+	}
+	intr_set_level(old_level);
+
+	if (t != NULL)
+		palloc_free_page(t);
+}
+
 /* Function used as the basis for a kernel thread. */
 static void kernel_thread(thread_func *function, void *aux)
 {
@@ -565,8 +980,11 @@ static void init_thread(struct thread *t, const char *name, int priority)
 	t->original_priority = priority;
 	t->nice = 0;
 	t->recent_cpu = 0;
+	t->mlfqs_epoch = mlfqs_seconds;
+	t->stat_since = rdtsc();
+	t->exec_start = t->stat_since;
 	t->magic = THREAD_MAGIC;
-	list_init(&t->donations);
+	rb_init(&t->held_locks, lock_higher_donation, NULL);
 	/* Project 2: System Call */
 	list_init(&t->child_list);
 	sema_init(&t->load_sema, 0);
@@ -585,10 +1003,143 @@ static void init_thread(struct thread *t, const char *name, int priority)
    idle_thread. */
 static struct thread *next_thread_to_run(void)
 {
-	if (list_empty(&ready_list))
+	if (ready_rq.cnt == 0)
 		return idle_thread;
 	else
-		return list_entry(list_pop_front(&ready_list), struct thread, elem);
+		return ready_queue_pop();
+}
+
+/* runqueue_init - 런큐 RQ를 빈 런큐로 초기화한다.
+ */
+static void runqueue_init(struct runqueue *rq)
+{
+	for (int i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init(&rq->queues[i]);
+	rq->mask = 0;
+	rq->cnt = 0;
+	rq->background_cnt = 0;
+	rb_init(&rq->cfs_tree, cfs_less, NULL);
+	rq->min_vruntime = 0;
+	rq->cfs_load = 0;
+}
+
+/* ready_queue_push - 스레드 t를 t->priority에 해당하는 ready 큐의 끝에 넣고 mask를 갱신한다.
+ * 같은 우선순위의 스레드끼리는 FIFO 순서가 유지된다.
+ *
+ * -cfs에서는 t를 vruntime 순으로 cfs_tree에 넣는다. 양보하는 스레드는 지금까지 실행한 시간을 먼저 반영하고,
+ * 깨어나거나 새로 만들어진 스레드는 vruntime을 min_vruntime 이상으로 올려서 잠든 동안 쌓인 몫으로 CPU를 독점하지 못하게 한다.
+ */
+static void ready_queue_push(struct thread *t)
+{
+	struct runqueue *rq = &ready_rq;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	if (thread_cfs)
+	{
+		if (t->status == THREAD_RUNNING)
+			cfs_update_curr(t, rdtsc());
+		else
+			t->vruntime = MAX(t->vruntime, rq->min_vruntime);
+		rb_insert(&rq->cfs_tree, &t->rb_elem);
+		rq->cfs_load += thread_nice_weight(t->nice);
+	}
+	else
+	{
+		list_push_back(&rq->queues[t->priority], &t->elem);
+		rq->mask |= 1ULL << t->priority;
+	}
+	rq->cnt++;
+	if (t->background)
+		rq->background_cnt++;
+}
+
+/* ready_queue_pop - 가장 높은 우선순위 큐의 맨 앞 스레드를 꺼내 반환한다.
+ * 가장 높은 우선순위는 mask의 최상위 비트 위치이다.
+ */
+static struct thread *ready_queue_pop(void)
+{
+	struct runqueue *rq = &ready_rq;
+	struct thread *t;
+	int pri;
+
+	if (thread_cfs)
+	{
+		/* 가장 작은 vruntime을 가진 스레드를 꺼낸다. */
+		t = rb_entry(rb_min(&rq->cfs_tree), struct thread, rb_elem);
+		rb_remove(&rq->cfs_tree, &t->rb_elem);
+		rq->cfs_load -= thread_nice_weight(t->nice);
+		rq->min_vruntime = MAX(rq->min_vruntime, t->vruntime);
+	}
+	else
+	{
+		pri = 63 - __builtin_clzll(rq->mask);
+		t = list_entry(list_pop_front(&rq->queues[pri]), struct thread, elem);
+		if (list_empty(&rq->queues[pri]))
+			rq->mask &= ~(1ULL << pri);
+	}
+	rq->cnt--;
+	if (t->background)
+		rq->background_cnt--;
+	return t;
+}
+
+/* ready_queue_remove - READY 상태의 스레드 t를 자신이 속한 ready 큐에서 제거한다.
+ */
+static void ready_queue_remove(struct thread *t)
+{
+	struct runqueue *rq = &ready_rq;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(t->status == THREAD_READY);
+
+	if (thread_cfs)
+	{
+		rb_remove(&rq->cfs_tree, &t->rb_elem);
+		rq->cfs_load -= thread_nice_weight(t->nice);
+	}
+	else
+	{
+		list_remove(&t->elem);
+		if (list_empty(&rq->queues[t->priority]))
+			rq->mask &= ~(1ULL << t->priority);
+	}
+	rq->cnt--;
+	if (t->background)
+		rq->background_cnt--;
+}
+
+/* ready_queue_drain - ready 큐의 모든 스레드를 높은 우선순위부터 꺼내 LIST에 옮긴다.
+ * 꺼낸 스레드는 READY 상태로 남으므로 호출자는 인터럽트를 켜기 전에 ready_queue_push()로 모두 되돌려야 한다.
+ */
+static void ready_queue_drain(struct list *list)
+{
+	struct runqueue *rq = &ready_rq;
+	int pri;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(!thread_cfs);
+
+	list_init(list);
+	for (pri = PRI_MAX; pri >= PRI_MIN; pri--)
+		if (!list_empty(&rq->queues[pri]))
+			list_splice(list_end(list), list_begin(&rq->queues[pri]), list_end(&rq->queues[pri]));
+	rq->mask = 0;
+	rq->cnt = 0;
+	rq->background_cnt = 0;
+}
+
+/* ready_queue_max_priority - ready 큐에 있는 스레드 중 가장 높은 우선순위를 반환한다.
+ * ready 큐가 비어있다면 -1을 반환한다. -cfs에서는 우선순위 큐를 쓰지 않으므로 항상 -1이다.
+ */
+static int ready_queue_max_priority(void)
+{
+	uint64_t mask = ready_rq.mask;
+
+	if (mask == 0)
+		return -1;
+	return 63 - __builtin_clzll(mask);
 }
 
 /* Use iretq to launch the thread */
@@ -690,18 +1241,12 @@ static void thread_launch(struct thread *th)
 /* do_schedule - 새 스레드를 스케줄합니다. 진입시 인터럽트가 꺼져 있어야 한다.
  * 이 함수는 현재 스레드의 상태를 status로 변경한 다음 다른 스레드를 찾아 실행한다.
  * schedule()에서 printf()를 호출하는 것은 안전하지 않다.
- * 매 스케줄 실행 시마다 destruction_req 리스트에 있는 스레드를 해제한다.
+ * 종료된 스레드의 페이지는 여기서 해제하지 않고 reaper 스레드가 모아서 회수한다.
  */
 static void do_schedule(int status)
 {
 	ASSERT(intr_get_level() == INTR_OFF);
 	ASSERT(thread_current()->status == THREAD_RUNNING);
-	while (!list_empty(&destruction_req))
-	{
-		struct thread *victim =
-			list_entry(list_pop_front(&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
-	}
 	thread_current()->status = status;
 	schedule();
 }
@@ -713,10 +1258,40 @@ static void schedule(void)
 {
 	struct thread *curr = running_thread();
 	struct thread *next = next_thread_to_run();
+	uint64_t now = rdtsc();
 
 	ASSERT(intr_get_level() == INTR_OFF);
 	ASSERT(curr->status != THREAD_RUNNING);
 	ASSERT(is_thread(next));
+
+	/* 스케줄러 통계: curr는 지금까지 실행 중이었고, next는 READY(idle은 BLOCKED) 상태였다.
+	 * READY로 남는 curr는 선점된 것이고, BLOCKED가 되는 curr는 스스로 CPU를 내놓은 것이다. */
+	schedstat_charge(curr, THREAD_RUNNING, now);
+	if (curr != next && curr != idle_thread)
+	{
+		if (curr->status == THREAD_READY)
+		{
+			curr->stat.involuntary_switches++;
+			sched_total.involuntary_switches++;
+		}
+		else if (curr->status == THREAD_BLOCKED)
+		{
+			curr->stat.voluntary_switches++;
+			sched_total.voluntary_switches++;
+		}
+	}
+	schedstat_charge(next, next->status, now);
+	if (curr != next)
+		trace(TRACE_SCHED, TRACE_INSTANT, next->tid, curr->status);
+
+	/* -cfs: READY가 되는 curr는 ready_queue_push()에서 이미 실행 시간을 반영했다. */
+	if (thread_cfs)
+	{
+		if (curr->status != THREAD_READY)
+			cfs_update_curr(curr, now);
+		next->exec_start = now;
+	}
+
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
 
@@ -735,13 +1310,15 @@ static void schedule(void)
 		   pull out the rug under itself.
 		   We just queuing the page free reqeust here because the page is
 		   currently used by the stack.
-		   The real destruction logic will be called at the beginning of the
-		   schedule(). */
+		   The page is reclaimed later by the reaper thread, which
+		   we wake up here if it is waiting for work. */
 		if (curr && curr->status == THREAD_DYING && curr != initial_thread)
 		{
 			ASSERT(curr != next);
 			list_push_back(&destruction_req, &curr->elem);
 			list_remove(&curr->a_elem);
+			if (reaper_thread != NULL && reaper_thread->status == THREAD_BLOCKED)
+				thread_unblock(reaper_thread);
 		}
 
 		// 스레드를 전환하기 전에 먼저 현재 실행 중인 스레드를 저장한다.
@@ -762,30 +1339,12 @@ static tid_t allocate_tid(void)
 	return tid;
 }
 
-/* higher_priority - ready_list와 waiter를 우선순위 내림차순으로 정렬하기 위한 비교 함수.
- */
-bool higher_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-{
-	struct thread *ta = list_entry(a, struct thread, elem);
-	struct thread *tb = list_entry(b, struct thread, elem);
-	return ta->priority > tb->priority;
-}
-
-/* less_wakeup_ticks - sleep_list를 정렬하기 위한 비교 함수. list_less_func typedef로 선언되어 있다.
- */
-bool less_wakeup_ticks(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-{
-	struct thread *ta = list_entry(a, struct thread, elem);
-	struct thread *tb = list_entry(b, struct thread, elem);
-	return ta->wakeup_ticks < tb->wakeup_ticks;
-}
-
-/* thread_sleep - 현재 실행 중인 스레드들 재운다.
- * sleep_list에 wakeup_ticks 기준으로 오름차순 삽입하고 스레드의 상태를 BLOCKED 상태로 전환한다.
+/* thread_sleep - 현재 실행 중인 스레드를 ticks까지 재운다.
+ * 스레드의 sleep_timer를 타이밍 휠에 등록하고(O(1)) 스레드의 상태를 BLOCKED 상태로 전환한다.
  * thread_block() 내부적으로 schedule()을 호출하여 스케줄링을 수행한다.
  * 
  * Idle 스레드는 thread_sleep()을 호출할 수 없다.
- * 스레드 리스트를 조작할때, 인터럽트를 비활성화하고 조작이 끝나면 다시 활성화해야 한다.
+ * 타이머 등록과 BLOCKED 전환 사이에 타이머가 만료되지 않도록 인터럽트를 비활성화해야 한다.
  */
 void thread_sleep(int64_t ticks)
 {
@@ -795,34 +1354,99 @@ void thread_sleep(int64_t ticks)
 	ASSERT(t != idle_thread);
 
 	t->wakeup_ticks = ticks;
-	list_insert_ordered(&sleep_list, &t->elem, (list_less_func *)less_wakeup_ticks, NULL);
+	timer_add(&t->sleep_timer, ticks, thread_wakeup, t);
 	thread_block();
 	intr_set_level(old_level);
 }
 
-/* thread_wakeup - 잠들어 있는 스레드를 깨운다.
- * sleep_list를 순회하면서 wakeup_ticks이 현재 os_ticks보다 작아진 스레드를 깨운다.
- * sleep_list는 wakeup_ticks 기준으로 오름차순으로 정렬되어 있다.
- * 깨어난 스레드는 READY 상태로 전환되고 ready_list에 priority 기준으로 내림차순 삽입된다.
+/* thread_wakeup - sleep_timer가 만료된 스레드 T를 깨운다.
+ * 깨어난 스레드는 READY 상태로 전환되고 자신의 우선순위에 해당하는 ready 큐에 삽입된다.
  * 
  * 이 함수는 타이머 인터럽트 핸들러에서 호출된다. 따라서 이 함수는 외부 인터럽트 컨텍스트에서 실행된다.
- * 스레드 리스트를 조작할때, 인터럽트를 비활성화하고 조작이 끝나면 다시 활성화해야 한다.
  */
-void thread_wakeup(int64_t os_ticks)
+static void thread_wakeup(void *t_)
 {
-	if (list_empty(&sleep_list))
-		return;
-	enum intr_level old_level = intr_disable();
-	struct thread *t;
+	struct thread *t = t_;
+
+	ASSERT(is_thread(t));
+	thread_unblock(t);
+}
 
-	while (!list_empty(&sleep_list))
+/* schedstat_charge - 스레드 T가 STATUS 상태로 보낸 시간(마지막 상태 변경부터 NOW까지)을 통계에 더한다.
+ * READY 상태를 벗어나는 것은 스케줄되는 경우뿐이므로, READY 시간은 곧 ready-to-run 지연 시간이다.
+ * Idle 스레드의 시간은 전체 합계에 더하지 않는다. 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+static void schedstat_charge(struct thread *t, enum thread_status status, uint64_t now)
+{
+	uint64_t delta = now - t->stat_since;
+	struct schedstat *stats[2] = {&t->stat, t != idle_thread ? &sched_total : NULL};
+	int bucket;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	bucket = delta >> SCHEDSTAT_SHIFT == 0 ? 0 : MIN(63 - __builtin_clzll(delta) - SCHEDSTAT_SHIFT, SCHEDSTAT_BUCKETS - 1);
+	for (int i = 0; i < 2 && stats[i] != NULL; i++)
 	{
-		t = list_entry(list_front(&sleep_list), struct thread, elem);
-		if (t->wakeup_ticks > os_ticks)
-			break;
-		list_pop_front(&sleep_list);
-		list_insert_ordered(&ready_list, &t->elem, (list_less_func *)higher_priority, NULL);
-		t->status = THREAD_READY;
+		if (status == THREAD_RUNNING)
+			stats[i]->run_cycles += delta;
+		else if (status == THREAD_READY)
+		{
+			stats[i]->ready_cycles += delta;
+			stats[i]->latency[bucket]++;
+		}
+		else
+			stats[i]->blocked_cycles += delta;
 	}
-	intr_set_level(old_level);
-}
\ No newline at end of file
+	t->stat_since = now;
+}
+
+/* cfs_less - cfs_tree를 vruntime 오름차순으로 정렬하기 위한 비교 함수.
+ */
+static bool cfs_less(const struct rb_elem *a, const struct rb_elem *b, void *aux UNUSED)
+{
+	struct thread *ta = rb_entry(a, struct thread, rb_elem);
+	struct thread *tb = rb_entry(b, struct thread, rb_elem);
+	return ta->vruntime < tb->vruntime;
+}
+
+/* cfs_update_curr - 실행 중인 스레드 T가 exec_start부터 NOW까지 실행한 시간을 가중치로 나누어 vruntime에 더한다.
+ * nice 0인 스레드의 vruntime은 실제 실행 시간과 같은 속도로, 가중치가 큰 스레드는 더 느리게 증가한다.
+ * T는 cfs_tree에 들어있으면 안 된다. 인터럽트가 꺼진 상태에서 호출되어야 한다.
+ */
+static void cfs_update_curr(struct thread *t, uint64_t now)
+{
+	struct runqueue *rq = &ready_rq;
+	uint64_t min_vruntime;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (t == idle_thread)
+		return;
+	t->vruntime += (now - t->exec_start) * NICE_0_WEIGHT / thread_nice_weight(t->nice);
+	t->exec_start = now;
+
+	min_vruntime = t->vruntime;
+	if (!rb_empty(&rq->cfs_tree))
+		min_vruntime = MIN(min_vruntime, rb_entry(rb_min(&rq->cfs_tree), struct thread, rb_elem)->vruntime);
+	rq->min_vruntime = MAX(rq->min_vruntime, min_vruntime);
+}
+
+/* cfs_slice - 실행 중인 스레드 T가 한 번에 실행할 tick 수를 반환한다.
+ * CFS_LATENCY를 런큐의 전체 가중치 중 T의 가중치 비율만큼 나누어 주되, CFS_MIN_GRANULARITY보다 짧지 않게 한다.
+ */
+static unsigned cfs_slice(struct thread *t)
+{
+	unsigned long weight = thread_nice_weight(t->nice);
+	unsigned slice = CFS_LATENCY * weight / (ready_rq.cfs_load + weight);
+
+	return MAX(slice, CFS_MIN_GRANULARITY);
+}
+
+/* cfs_should_preempt - cfs_tree에 실행 중인 스레드 T보다 vruntime이 작은 스레드가 있다면 true를 반환한다.
+ */
+static bool cfs_should_preempt(struct thread *t)
+{
+	struct rb_elem *min = rb_min(&ready_rq.cfs_tree);
+
+	return min != NULL && rb_entry(min, struct thread, rb_elem)->vruntime < t->vruntime;
+}
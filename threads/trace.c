@@ -0,0 +1,168 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+#ifdef FILESYS
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#endif
+
+/* Number of events kept.  Must be a power of 2. */
+#define TRACE_EVENTS 8192
+
+/* Names accepted by -trace=, indexed by enum trace_type. */
+static const char *trace_names[TRACE_TYPE_CNT] = {
+	"sched", "fault", "swap-in", "swap-out",
+	"disk-read", "disk-write", "syscall",
+};
+
+unsigned trace_mask;
+
+static struct trace_event events[TRACE_EVENTS];
+static uint64_t event_cnt;      /* Events ever recorded. */
+static bool drained;            /* Already saved or dumped? */
+
+static void trace_stop (struct trace_header *);
+
+/* Enables the comma-separated event TYPES, or every type if
+   TYPES is null or "all".  Returns false if a name is not
+   recognized. */
+bool
+trace_parse (const char *types) {
+	char buf[128];
+	char *name, *save_ptr;
+
+	if (types == NULL || !strcmp (types, "all")) {
+		trace_mask = (1u << TRACE_TYPE_CNT) - 1;
+		return true;
+	}
+
+	strlcpy (buf, types, sizeof buf);
+	for (name = strtok_r (buf, ",", &save_ptr); name != NULL;
+	     name = strtok_r (NULL, ",", &save_ptr)) {
+		int type;
+
+		for (type = 0; type < TRACE_TYPE_CNT; type++)
+			if (!strcmp (name, trace_names[type]))
+				break;
+		if (type == TRACE_TYPE_CNT)
+			return false;
+		trace_mask |= 1u << type;
+	}
+	return true;
+}
+
+/* Appends an event of TYPE to the ring, overwriting the oldest
+   event if the ring is full.  Use trace() instead, which skips
+   the call for disabled types. */
+void
+trace_record (enum trace_type type, enum trace_phase phase,
+              uint64_t arg0, uint64_t arg1) {
+	struct trace_event *e;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (drained) {
+		intr_set_level (old_level);
+		return;
+	}
+	e = &events[event_cnt++ & (TRACE_EVENTS - 1)];
+	e->tsc = rdtsc ();
+	e->tid = thread_current ()->tid;
+	e->type = type;
+	e->phase = phase;
+	e->reserved = 0;
+	e->arg0 = arg0;
+	e->arg1 = arg1;
+	intr_set_level (old_level);
+}
+
+/* Stops tracing and fills in H for the events in the ring.  The
+   oldest of them is then events[(event_cnt - H->event_cnt) %
+   TRACE_EVENTS]. */
+static void
+trace_stop (struct trace_header *h) {
+	enum intr_level old_level = intr_disable ();
+
+	trace_mask = 0;
+	drained = true;
+	intr_set_level (old_level);
+
+	h->magic = TRACE_MAGIC;
+	h->event_cnt = event_cnt < TRACE_EVENTS ? event_cnt : TRACE_EVENTS;
+	h->lost_cnt = event_cnt - h->event_cnt;
+	h->tsc_hz = timer_tsc_hz ();
+}
+
+/* Prints 32 bytes starting at P as one line of hex digits. */
+static void
+dump_line (const void *p) {
+	const uint8_t *bytes = p;
+	char line[65];
+	int i;
+
+	for (i = 0; i < 32; i++)
+		snprintf (line + i * 2, 3, "%02x", bytes[i]);
+	printf ("Trace: %s\n", line);
+}
+
+/* Stops tracing and prints the header and every event in the
+   ring to the console, one 32-byte record per line, between
+   "Trace: begin" and "Trace: end" lines. */
+void
+trace_dump (void) {
+	struct trace_header h;
+	uint64_t i;
+
+	trace_stop (&h);
+	printf ("Trace: begin\n");
+	dump_line (&h);
+	for (i = event_cnt - h.event_cnt; i < event_cnt; i++)
+		dump_line (&events[i & (TRACE_EVENTS - 1)]);
+	printf ("Trace: end\n");
+}
+
+/* Called at power off.  Dumps the trace to the console if it is
+   enabled and has not been saved yet. */
+void
+trace_done (void) {
+	if (trace_mask != 0 && !drained)
+		trace_dump ();
+}
+
+#ifdef FILESYS
+/* Stops tracing and writes the header and every event in the
+   ring to a new file named FILE_NAME. */
+void
+trace_save (const char *file_name) {
+	struct trace_header h;
+	struct file *file;
+	uint64_t first, head;
+	off_t size;
+
+	trace_stop (&h);
+	size = sizeof h + h.event_cnt * sizeof *events;
+	if (!filesys_create (file_name, size))
+		PANIC ("%s: create failed", file_name);
+	file = filesys_open (file_name);
+	if (file == NULL)
+		PANIC ("%s: open failed", file_name);
+
+	/* The ring wraps at most once, so it is written in up to two
+	   pieces. */
+	first = (event_cnt - h.event_cnt) & (TRACE_EVENTS - 1);
+	head = h.event_cnt < TRACE_EVENTS - first ? h.event_cnt : TRACE_EVENTS - first;
+	if (file_write (file, &h, sizeof h) != sizeof h
+	    || file_write (file, &events[first], head * sizeof *events)
+	       != (off_t) (head * sizeof *events)
+	    || file_write (file, events, (h.event_cnt - head) * sizeof *events)
+	       != (off_t) ((h.event_cnt - head) * sizeof *events))
+		PANIC ("%s: write failed", file_name);
+	file_close (file);
+	printf ("Trace: saved %llu events to '%s'.\n", h.event_cnt, file_name);
+}
+#endif
@@ -14,12 +14,16 @@
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/pageops.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "intrinsic.h"
 #include "lib/kernel/hash.h"
+#include "devices/timer.h"
+#include <vclock.h>
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -28,6 +32,7 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static bool vclock_map (struct thread *t);
 void set_userstack(char **argv, int argc, struct intr_frame *if_);
 struct thread *get_child_process(tid_t pid);
 static struct thread *main_thread; // tid 1 thread
@@ -119,6 +124,10 @@ static bool duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	if (is_kernel_vaddr (va))
 		return true;
 
+	/* 시계 페이지는 복사하지 않는다. 자식에는 __do_fork()가 따로 매핑한다. */
+	if (va == (void *) VCLOCK_ADDR)
+		return true;
+
 	/* 2. Resolve VA from the parent's page map level 4. */
 	/* 부모의 페이지 맵 레벨 4에서 VA를 해결합니다.*/
 	parent_page = pml4_get_page (parent->pml4, va);
@@ -137,7 +146,7 @@ static bool duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	 *    TODO: check whether parent's page is writable or not (set WRITABLE
 	 *    TODO: according to the result). */
 	/* 해석: 부모의 페이지를 새 페이지로 복제하고 부모의 페이지가 쓰기 가능한지 여부를 확인하십시오 (결과에 따라 WRITABLE을 설정하십시오). */
-	memcpy (newpage, parent_page, PGSIZE);
+	copy_page (newpage, parent_page);
 	writable = is_writable (pte);
 
 	/* 5. Add new page to child's page table at address VA with WRITABLE permission. */
@@ -170,7 +179,7 @@ __do_fork (void *aux) {
 
 	/* 2. Duplicate PT */
 	current->pml4 = pml4_create();
-	if (current->pml4 == NULL)
+	if (current->pml4 == NULL || !vclock_map (current))
 		goto error;
 
 	process_activate (current);
@@ -302,6 +311,14 @@ void process_exit (void) {
 	sema_down(&t->exit_sema);
 }
 
+/* vclock_map - 커널의 시계 페이지를 T의 주소 공간 VCLOCK_ADDR에 읽기 전용으로 매핑한다.
+ * 사용자 프로그램은 이 페이지에서 시스템 콜 없이 시각을 읽는다. (lib/user/clock.c 참조)
+ */
+static bool
+vclock_map (struct thread *t) {
+	return pml4_set_page (t->pml4, (void *) VCLOCK_ADDR, timer_vclock_page (), false);
+}
+
 /* Free the current process's resources. */
 static void
 process_cleanup (void) {
@@ -324,6 +341,8 @@ process_cleanup (void) {
 		 */
 		curr->pml4 = NULL;
 		pml4_activate (NULL);
+		/* 공유 시계 페이지는 pml4_destroy()가 해제하지 않도록 먼저 매핑을 지운다. */
+		pml4_clear_page (pml4, (void *) VCLOCK_ADDR);
 		pml4_destroy (pml4);
 	}
 }
@@ -412,7 +431,7 @@ static bool load (const char *file_name, struct intr_frame *if_) {
 
 	/* Allocate and activate page directory. */
 	t->pml4 = pml4_create ();
-	if (t->pml4 == NULL)
+	if (t->pml4 == NULL || !vclock_map (t))
 		goto done;
 	process_activate (thread_current ());
 
@@ -675,8 +694,8 @@ lazy_load_segment (struct page *page, void *aux) {
 	struct lazy_load_arg *lazy_load_arg = (struct lazy_load_arg *)aux;
 	file_seek(lazy_load_arg->file, lazy_load_arg->ofs);
 
+	// 프레임은 페이지에 연결된 채로 두고, 페이지를 해제할 때 vm_dealloc_page()가 놓는다.
 	if(file_read(lazy_load_arg->file, page->frame->kva, lazy_load_arg->read_bytes)!= (int)(lazy_load_arg->read_bytes)){
-			palloc_free_page(page->frame->kva);
 			return false;
 	}
 
@@ -733,7 +752,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		/* lazy_load_segment에 정보를 전달하도록 aux를 설정합니다.*/
 		//void **aux = (file, &page_read_bytes, &page_zero_bytes, &ofs);
 		
-		struct lazy_load_arg *lazy_load_arg = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
+		struct lazy_load_arg *lazy_load_arg = kmem_cache_alloc(lazy_load_arg_cache);
+		if (lazy_load_arg == NULL)
+			return false;
 		lazy_load_arg->file = file;
 		lazy_load_arg->ofs = ofs;
 		lazy_load_arg->read_bytes = page_read_bytes;
@@ -16,6 +16,8 @@
 #include "devices/input.h"
 #include "include/threads/palloc.h"
 #include "vm/vm.h"
+#include "threads/trace.h"
+#include <vclock.h>
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
@@ -43,6 +45,9 @@ struct file *get_file_from_fd(int fd);
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
 
+int schedstat (pid_t pid, struct schedstat *stat);
+int irqsoff (struct irqsoff_stat *stat, bool reset);
+
 static struct intr_frame *frame;
 /* System call.
  *
@@ -59,7 +64,7 @@ static struct intr_frame *frame;
 
 void
 syscall_init (void) {
-	lock_init(&filesys_lock);
+	rwlock_init(&filesys_lock);
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
@@ -86,6 +91,7 @@ void syscall_handler (struct intr_frame *f) {
 	
 	uint64_t syscall_num = f->R.rax;
 	thread_current()->stack_rsp = f->rsp;
+	trace(TRACE_SYSCALL, TRACE_BEGIN, syscall_num, f->R.rdi);
 	switch (syscall_num)
 	{
 	case SYS_HALT:
@@ -136,10 +142,17 @@ void syscall_handler (struct intr_frame *f) {
 	case SYS_MUNMAP:
 		munmap(f->R.rdi);
 		break;
+	case SYS_SCHEDSTAT:
+		f->R.rax = schedstat(f->R.rdi, (struct schedstat *) f->R.rsi);
+		break;
+	case SYS_IRQSOFF:
+		f->R.rax = irqsoff((struct irqsoff_stat *) f->R.rdi, f->R.rsi);
+		break;
 	default:
 		thread_exit();
 		break;
 	}
+	trace(TRACE_SYSCALL, TRACE_END, syscall_num, f->R.rax);
 }
 
 /* half - include/threads/init.h 에 선언된 power_off()를 선언하여 핀토스를 종료한다.
@@ -225,10 +238,10 @@ int wait(pid_t pid) {
  * 새 파일을 열려면 시스템 호출이 필요한 별도의 작업입니다.
  */
 bool create(const char *file, unsigned initial_size) {
-	lock_acquire(&filesys_lock);
+	rwlock_write_acquire(&filesys_lock);
 	check_address(file);
 	bool success = filesys_create(file, initial_size); 
-	lock_release(&filesys_lock);
+	rwlock_write_release(&filesys_lock);
 	return success;
 }
 
@@ -239,9 +252,9 @@ bool create(const char *file, unsigned initial_size) {
  */
 bool remove(const char *file) {
 	check_address(file);
-	lock_acquire(&filesys_lock);
+	rwlock_write_acquire(&filesys_lock);
 	bool success = filesys_remove(file);
-	lock_release(&filesys_lock);
+	rwlock_write_release(&filesys_lock);
 	return success;
 }
 
@@ -266,16 +279,16 @@ bool remove(const char *file) {
  */
 int open(const char *file) {
 	check_address(file);
-	lock_acquire(&filesys_lock);
+	rwlock_write_acquire(&filesys_lock);
 	struct file *file_open = filesys_open(file);
 	if (file_open == NULL){
-		lock_release(&filesys_lock);
+		rwlock_write_release(&filesys_lock);
 		return -1;
 	}
 	int fd = add_file_to_fdt(file_open);
 	if (fd == -1)
 		file_close(file_open);
-	lock_release(&filesys_lock);
+	rwlock_write_release(&filesys_lock);
 	return fd;
 }
 
@@ -295,6 +308,7 @@ int filesize(int fd) {
  * 실제로 읽은 바이트 수(파일 끝에서 0) 또는 
  * 파일을 읽을 수 없는 경우(파일 끝이 아닌 다른 조건으로 인해) -1을 반환한다.
  * fd 0은 input_getc()를 사용하여 키보드에서 읽는다. 
+ * 파일 읽기는 filesys_lock을 읽기 모드로 잡으므로 여러 프로세스가 동시에 읽을 수 있다.
  */
 
 /**정적 변수로 buf2를 선언 했기 때문에 check_address안에서
@@ -320,9 +334,10 @@ int read(int fd, void *buffer, unsigned size) {
 		if(_page && !_page->writable){
 			exit(-1);
 		}
-		lock_acquire(&filesys_lock);
+		struct rwlock_read hold;
+		rwlock_read_acquire(&filesys_lock, &hold);
 		byte = file_read(_file, buffer, size);
-		lock_release(&filesys_lock);
+		rwlock_read_release(&filesys_lock, &hold);
 	}
 	return byte;
 }
@@ -348,9 +363,9 @@ int write(int fd, const void *buffer, unsigned size) {
 		if (_file == NULL) {
 			return -1;
 		}
-		lock_acquire(&filesys_lock);
+		rwlock_write_acquire(&filesys_lock);
 		int byte = file_write(_file, buffer, size);
-		lock_release(&filesys_lock);
+		rwlock_write_release(&filesys_lock);
 		return byte;
 	}	
 }
@@ -473,6 +488,10 @@ void *mmap (void *addr, size_t length, int writable, int fd, off_t offset){
 	if(spt_find_page(&thread_current()->spt, addr))
 		return NULL;
 
+	// 매핑하려는 영역이 공유 시계 페이지와 겹칠 때
+	if((uint64_t) addr <= VCLOCK_ADDR && VCLOCK_ADDR < (uint64_t) addr + length)
+		return NULL;
+
 	//찾는 파일이 디스크에 없는 경우
 	struct file *target = get_file_from_fd(fd);
 	if(target == NULL)	
@@ -491,4 +510,35 @@ void *mmap (void *addr, size_t length, int writable, int fd, off_t offset){
 
 void munmap (void *addr){
 	do_munmap(addr);
-}
\ No newline at end of file
+}
+/* schedstat - pid가 PID인 스레드의 스케줄러 통계를 STAT에 복사한다.
+ * PID가 0이면 종료된 스레드를 포함한 시스템 전체 합계를 복사한다.
+ * 시간은 TSC 사이클 단위이다. 성공하면 0을, 해당 스레드가 없으면 -1을 반환한다.
+ */
+int schedstat (pid_t pid, struct schedstat *stat) {
+	struct schedstat kstat;
+
+	check_address((uintptr_t) stat);
+	check_address((uintptr_t) stat + sizeof *stat - 1);
+	if (!thread_get_schedstat(pid, &kstat))
+		return -1;
+	memcpy(stat, &kstat, sizeof *stat);
+	return 0;
+}
+
+/* irqsoff - 인터럽트가 꺼져 있던 구간의 통계를 STAT에 복사한다. STAT이 NULL이면 복사하지 않는다.
+ * RESET이 참이면 복사한 뒤 통계를 비운다. 시간은 TSC 사이클 단위이며, 항상 0을 반환한다.
+ */
+int irqsoff (struct irqsoff_stat *stat, bool reset) {
+	if (stat != NULL) {
+		struct irqsoff_stat kstat;
+
+		check_address((uintptr_t) stat);
+		check_address((uintptr_t) stat + sizeof *stat - 1);
+		intr_irqsoff_get(&kstat);
+		memcpy(stat, &kstat, sizeof *stat);
+	}
+	if (reset)
+		intr_irqsoff_reset();
+	return 0;
+}
@@ -5,6 +5,7 @@
 #include "devices/disk.h"
 #include "threads/vaddr.h"
 #include "threads/mmu.h"	
+#include "threads/trace.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -65,11 +66,13 @@ anon_swap_in (struct page *page, void *kva) {
 		return false;
 	}
 
+	trace(TRACE_SWAP_IN, TRACE_BEGIN, (uintptr_t) page->va, find_slot);
 	for(int i = 0; i <SECTORS_PER_PAGE; i++){	//디스크로부터 읽어온다.
 		disk_read(swap_disk, find_slot *SECTORS_PER_PAGE+ i, kva + DISK_SECTOR_SIZE*i);
 	}
 
 	bitmap_set(swap_table,find_slot, false);	//해당 슬롯이 스왑인 되어있다는 표시
+	trace(TRACE_SWAP_IN, TRACE_END, (uintptr_t) page->va, find_slot);
 
 	return true;
 }
@@ -92,25 +95,60 @@ anon_swap_out (struct page *page) {
 	한 페이지를 디스크에 써주기 위해 SECTORS_PER_PAGE 개의 섹터에 저장해야 한다.
 	이때 디스크에 각 섹터 크기의 DISK_SECTOR_SIZE만큼 써준다.
 	*/
+	trace(TRACE_SWAP_OUT, TRACE_BEGIN, (uintptr_t) page->va, empty_slot);
 	for(int i = 0; i <SECTORS_PER_PAGE; i++){
-		disk_write(swap_disk, empty_slot *SECTORS_PER_PAGE + i , page->va + DISK_SECTOR_SIZE * i);
+		disk_write(swap_disk, empty_slot *SECTORS_PER_PAGE + i , page->frame->kva + DISK_SECTOR_SIZE * i);
 	}
 
 	/*
 	swap table의 해당 페이지에 대한 swap slot의 비트를 true로 바꿔주고
 	해당 페이지의 PTE에서 present bit를 0으로 바꿔준다.
 	이제 프로세스가 이 페이지에 접근하면 page fault가 뜬다.
+	내보내는 스레드는 페이지의 주인이 아닐 수 있으므로 내용은 frame->kva에서 읽고 PTE는 page->pml4에서 지운다.
 	*/
 
 	bitmap_set(swap_table, empty_slot, true); //스왑 테이블에서 해당 스왑 슬롯을 사용 중으로 설정한다.
-	pml4_clear_page(thread_current()->pml4, page->va);
+	pml4_clear_page(page->pml4, page->va);
 
 	//페이지에 대한 스왑 인덱스 값을 이 페이지가 저장된 swap slot의 번호로 써준다.
 	anon_page->swap_sector = empty_slot;
+	trace(TRACE_SWAP_OUT, TRACE_END, (uintptr_t) page->va, empty_slot);
 
 	return true;
 }
 
+/* anon_swap_copy - 스왑 아웃된 SRC의 내용을 새 스왑 슬롯에 복사해 DST에 준다.
+ * fork 때 부모의 프레임 없는 익명 페이지를 자식에게 복사하는 데 쓴다.
+ * DST는 아직 VM_UNINIT 상태인 익명 페이지여야 하며, 성공하면 스왑 아웃된 익명 페이지가 된다. */
+bool
+anon_swap_copy (struct page *dst, struct page *src) {
+	int src_slot = src->anon.swap_sector;
+	uint8_t buf[DISK_SECTOR_SIZE];
+
+	if(src_slot == -1 || bitmap_test(swap_table, src_slot) == false){
+		return false;
+	}
+
+	size_t dst_slot = bitmap_scan_and_flip(swap_table, 0, 1, false);
+	if(dst_slot == BITMAP_ERROR){
+		return false;
+	}
+
+	//디스크 간 직접 복사는 없으므로 섹터 하나 크기의 버퍼를 거친다.
+	for(size_t i = 0; i < SECTORS_PER_PAGE; i++){
+		disk_read(swap_disk, src_slot * SECTORS_PER_PAGE + i, buf);
+		disk_write(swap_disk, dst_slot * SECTORS_PER_PAGE + i, buf);
+	}
+
+	//uninit 페이지를 익명 페이지로 바꾼 뒤 복사한 슬롯을 가리키게 한다.
+	if(!dst->uninit.page_initializer(dst, VM_ANON, NULL)){
+		bitmap_reset(swap_table, dst_slot);
+		return false;
+	}
+	dst->anon.swap_sector = dst_slot;
+	return true;
+}
+
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 /*익명 페이지를 파괴하라. 페이지는 호출자에 의하여 해제된다 */
 static void
@@ -4,6 +4,7 @@
 #include "vm/vm.h"
 #include "userprog/process.h"
 #include "threads/vaddr.h"
+#include "threads/slab.h"
 #include "vm/file.h"
 #include "userprog/syscall.h"
 
@@ -59,16 +60,25 @@ file_backed_swap_in (struct page *page, void *kva) {
 	off_t offset = aux->ofs;
 	size_t page_read_bytes = aux->read_bytes;
 	size_t page_zero_bytes = aux->zero_bytes;
+	struct rwlock_read hold;
+	bool locked;
+	bool ok;
 
 	//파일에서 읽기 시작 위치를 설정
 	file_seek(file,offset);
 
-	lock_acquire(&filesys_lock);
+	// read()/write()가 filesys_lock을 잡은 채 사용자 버퍼에서 폴트가 나면 이미 잠금을 보유하고 있다.
+	// 다시 잡으면 기다리는 쓰기 스레드 뒤에서 자기 자신을 기다리게 되므로 그때는 잡지 않는다.
+	locked = !rwlock_write_held_by_current_thread(&filesys_lock)
+		&& !rwlock_read_held_by_current_thread(&filesys_lock);
+	if (locked)
+		rwlock_read_acquire(&filesys_lock, &hold);
 	//파일에서 페이지의 내용을 읽어와 메모리에 로드
-	if(file_read(file, kva, page_read_bytes) != (int)page_read_bytes){
+	ok = file_read(file, kva, page_read_bytes) == (int)page_read_bytes;
+	if (locked)
+		rwlock_read_release(&filesys_lock, &hold);
+	if (!ok)
 		return false;
-	}
-	lock_release(&filesys_lock);
 	//페이지의 남은 부분을 0으로 초기화
 	memset(kva + page_read_bytes, 0, page_zero_bytes);
 
@@ -94,13 +104,14 @@ static void
 file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
 	struct lazy_load_arg *file_aux = (struct lazy_load_arg *)file_page->aux;
-	struct thread *t = thread_current();
 
-	if(pml4_is_dirty(t->pml4, page->va)){			
-		file_write_at(file_aux->file, page->va, file_aux->read_bytes, file_aux->ofs);
-		pml4_set_dirty(t->pml4, page->va, 0);
+	// 교체할 때는 다른 프로세스가 호출하므로 주인의 pml4와 프레임의 kva를 쓴다.
+	// 프레임이 없으면 내보낼 때 이미 파일에 기록했다.
+	if(page->frame != NULL && pml4_is_dirty(page->pml4, page->va)){
+		file_write_at(file_aux->file, page->frame->kva, file_aux->read_bytes, file_aux->ofs);
+		pml4_set_dirty(page->pml4, page->va, 0);
 	}
-	pml4_clear_page(t->pml4, page->va);
+	pml4_clear_page(page->pml4, page->va);
 }
 
 /* Do the mmap */
@@ -123,7 +134,9 @@ do_mmap (void *addr, size_t length, int writable,
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-		struct lazy_load_arg *lazy_load_arg = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
+		struct lazy_load_arg *lazy_load_arg = kmem_cache_alloc(lazy_load_arg_cache);
+		if (lazy_load_arg == NULL)
+			return NULL;
 		lazy_load_arg->file = re_file;
 		lazy_load_arg->ofs = offset;
 		lazy_load_arg->read_bytes = page_read_bytes;
@@ -1,13 +1,18 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stddef.h>
+#include <stdio.h>
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
 #include "lib/kernel/hash.h"
 #include "threads/vaddr.h"
 #include "threads/vaddr.h"
 #include "threads/mmu.h"
+#include "threads/pageops.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "userprog/process.h"
 
 // 프레임 구조체를 관리하는 frame_table
@@ -15,6 +20,22 @@ struct list frame_table;
 struct list_elem * clock_ref;
 struct lock frame_table_lock;
 
+// struct page, struct frame, struct lazy_load_arg 전용 객체 캐시
+static struct kmem_cache *page_cache;
+static struct kmem_cache *frame_cache;
+struct kmem_cache *lazy_load_arg_cache;
+
+/* 2 MB 페이지 하나에 들어가는 4 kB 페이지 수. */
+#define HUGE_PAGE_CNT (LARGE_PGSIZE / PGSIZE)
+
+/* 통계. */
+static uint64_t fault_cnt;	 /* 프레임을 붙여서 처리한 폴트 수. */
+static uint64_t huge_tries;	 /* 0으로 채울 익명 페이지에서 난 폴트 수. */
+static uint64_t huge_maps;	 /* 그중 2 MB 페이지로 처리한 폴트 수. */
+static uint64_t huge_splits; /* 4 kB 페이지로 쪼갠 2 MB 페이지 수. */
+static uint64_t cow_shares;	 /* fork가 복사하지 않고 공유한 페이지 수. */
+static uint64_t cow_copies;	 /* 공유한 페이지에 쓰기가 일어나 복사한 수. */
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes.W
  * 각 서브시스템의 초기화 코드를 호출하여 가상 메모리 서브시스템을 초기화합니다.
@@ -32,6 +53,9 @@ void vm_init(void)
 	list_init(&frame_table);
 	clock_ref = list_begin(&frame_table);
 	lock_init(&frame_table_lock);
+	page_cache = kmem_cache_create("page", sizeof(struct page), NULL);
+	frame_cache = kmem_cache_create("frame", sizeof(struct frame), NULL);
+	lazy_load_arg_cache = kmem_cache_create("lazy_load_arg", sizeof(struct lazy_load_arg), NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -57,6 +81,15 @@ page_get_type(struct page *page)
 static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
 static struct frame *vm_evict_frame(void);
+static bool vm_handle_fault(struct intr_frame *f, void *addr,
+							bool user, bool write, bool not_present);
+static bool vm_try_huge(struct page *page);
+static bool vm_split_huge(uint64_t *pml4, void *va);
+static void vm_put_frame(struct page *page);
+static void frame_attach(struct frame *frame, struct page *page);
+static void frame_detach(struct frame *frame, struct page *page);
+static bool vm_share_page(struct supplemental_page_table *dst,
+						  struct supplemental_page_table *src, struct page *src_page);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -86,7 +119,7 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 		 * uninit_new를 호출한 후에 필드를 수정해야 합니다.
 		 */
 
-		struct page *page = (struct page *)malloc(sizeof(struct page));
+		struct page *page = kmem_cache_alloc(page_cache);
 		if (page == NULL)
 		{
 			return false;
@@ -104,11 +137,12 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 		}
 		if (new_initializer == NULL)
 		{
-			free(page);
+			kmem_cache_free(page_cache, page);
 			return false;
 		}
 		uninit_new(page, upage, init, type, aux, new_initializer);
 		page->writable = writable;
+		page->pml4 = thread_current()->pml4;
 
 		/* TODO: Insert the page into the spt. */
 		/* 페이지를 spt에 삽입합니다. */
@@ -120,30 +154,16 @@ err:
 
 /* Find VA from spt and return page. On error, return NULL. */
 /* spt로부터 VA를 찾고 페이지를 반환합니다. 에러인 경우 NULL을 반환합니다. */
+/* 검색 키는 스택의 struct page를 쓰므로 할당이 필요 없다. */
 struct page *
 spt_find_page(struct supplemental_page_table *spt UNUSED, void *va UNUSED)
 {
-	struct page *page = malloc(sizeof(struct page));
+	struct page key;
 	struct hash_elem *e;
-	if (page == NULL)
-	{
-		return NULL;
-	}
 
-	page->va = pg_round_down(va);
-	e = hash_find(&spt->hash_table, &page->hash_elem);
-
-	if (e != NULL)
-	{
-		struct page *found_page = hash_entry(e, struct page, hash_elem);
-		free(page);
-		return found_page;
-	}
-	else
-	{
-		free(page);
-		return NULL;
-	}
+	key.va = pg_round_down(va);
+	e = hash_find(&spt->hash_table, &key.hash_elem);
+	return e != NULL ? hash_entry(e, struct page, hash_elem) : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
@@ -176,14 +196,19 @@ static struct frame *
 vm_get_victim(void)
 {
 	struct frame *victim = NULL;
+	struct frame *fallback = NULL;
 	 /* TODO: The policy for eviction is up to you. */
-	struct thread* curr = thread_current();
+	/* 프레임의 주인은 다른 프로세스의 페이지일 수 있으므로 접근 비트는 주인의 pml4에서 본다. */
 	lock_acquire(&frame_table_lock);
 	for (clock_ref; clock_ref != list_end(&frame_table); clock_ref = list_next(clock_ref)){
 		victim = list_entry(clock_ref,struct frame,frame_elem);
+		//공유 중이거나 아직 페이지가 없는 프레임은 내보낼 수 없다.
+		if (victim->page == NULL || victim->ref_cnt > 1)
+			continue;
+		fallback = victim;
 		//bit가 1인 경우
-		if(pml4_is_accessed(curr->pml4,victim->page->va)){
-			pml4_set_accessed(curr->pml4,victim->page->va,0);
+		if(pml4_is_accessed(victim->page->pml4,victim->page->va)){
+			pml4_set_accessed(victim->page->pml4,victim->page->va,0);
 		}else{
 			lock_release(&frame_table_lock);
 			return victim;
@@ -193,9 +218,12 @@ vm_get_victim(void)
 
 	for (start; start != list_end(&frame_table); start = list_next(start)){
 		victim = list_entry(start,struct frame,frame_elem);
+		if (victim->page == NULL || victim->ref_cnt > 1)
+			continue;
+		fallback = victim;
 		//bit가 1인 경우
-		if(pml4_is_accessed(curr->pml4,victim->page->va)){
-			pml4_set_accessed(curr->pml4,victim->page->va,0);
+		if(pml4_is_accessed(victim->page->pml4,victim->page->va)){
+			pml4_set_accessed(victim->page->pml4,victim->page->va,0);
 		}else{
 			lock_release(&frame_table_lock);
 			return victim;
@@ -204,7 +232,7 @@ vm_get_victim(void)
 
 	lock_release(&frame_table_lock);
 	ASSERT(clock_ref != NULL);
-	return victim;
+	return fallback;
 }
 
 /* Evict one page and return the corresponding frame.
@@ -218,7 +246,16 @@ vm_evict_frame(void)
 	struct frame *victim UNUSED = vm_get_victim();
 	/* TODO: swap out the victim and return the evicted frame. */
 	/* 희생자를 교체하고 교체된 프레임을 반환합니다. */
+	if (victim == NULL)
+		return NULL;
+	/* 2 MB 페이지의 일부이면 먼저 주인의 주소 공간에서 4 kB 페이지로 쪼개서 이 페이지만 내보낸다. */
+	if (!vm_split_huge(victim->page->pml4, victim->page->va))
+		return NULL;
 	swap_out(victim->page);
+	/* 내보낸 페이지는 더 이상 이 프레임을 가리키지 않는다. */
+	lock_acquire(&frame_table_lock);
+	frame_detach(victim, victim->page);
+	lock_release(&frame_table_lock);
 	return victim;
 }
 
@@ -234,14 +271,20 @@ vm_evict_frame(void)
 static struct frame *
 vm_get_frame(void)
 {
-	struct frame *frame = (struct frame*)malloc(sizeof(struct frame)); // user_pool 에서 frame 가져오고, kva return해서 frame에 넣어준다.
+	struct frame *frame = kmem_cache_alloc(frame_cache); // user_pool 에서 frame 가져오고, kva return해서 frame에 넣어준다.
 	/* TODO: Fill this function. */
+	if (frame == NULL)
+		return NULL;
 	frame->kva = palloc_get_page(PAL_USER);
 	
 	if(frame->kva == NULL){ //frame에서 가용한 page가 없다면
 		/* 해당 로직은 evict한 frame을 받아오기에 이미 Frame_Table 존재해서 list_push_back()할 필요 없음 */
+		kmem_cache_free(frame_cache, frame);
 		frame = vm_evict_frame(); // 쫓아냄
-		frame->page = NULL;
+		if (frame == NULL)
+			return NULL;
+		ASSERT (frame->page == NULL && list_empty(&frame->pages));
+		frame->ref_cnt = 0;
 		//free(frame);
 		// PANIC("todo);
 		return frame;
@@ -251,6 +294,8 @@ vm_get_frame(void)
 	list_push_back(&frame_table,&frame->frame_elem);
 	lock_release(&frame_table_lock);
 	frame->page = NULL; //새 frame을 가져왔으니 page의 멤버를 초기화
+	list_init(&frame->pages);
+	frame->ref_cnt = 0;
 	
 	ASSERT (frame != NULL);
 	ASSERT (frame->page == NULL);
@@ -265,10 +310,43 @@ vm_stack_growth(void *addr UNUSED)
 
 /* Handle the fault on write_protected page */
 /* 쓰기 보호된 페이지에 대한 처리 */
+/* 다른 프로세스와 공유 중인 프레임이면 새 프레임에 내용을 복사해서 PAGE만의 것으로 바꾸고,
+ * 이미 PAGE만 매핑한 프레임이면 쓰기 권한만 되돌려 준다. */
 static bool
 vm_handle_wp(struct page *page UNUSED)
 {
-	return false;
+	uint64_t *pml4 = thread_current()->pml4;
+	struct frame *old = page->frame;
+	struct frame *frame;
+
+	if (old == NULL)
+		return false;
+
+	lock_acquire(&frame_table_lock);
+	if (old->ref_cnt == 1)
+	{
+		ASSERT(old->page == page);
+		lock_release(&frame_table_lock);
+		pml4_set_writable(pml4, page->va, true);
+		return true;
+	}
+	old->ref_cnt++; //복사하는 동안 교체되지 않도록 고정한다.
+	lock_release(&frame_table_lock);
+
+	frame = vm_get_frame();
+	if (frame != NULL)
+		copy_page(frame->kva, old->kva);
+	lock_acquire(&frame_table_lock);
+	old->ref_cnt--;
+	lock_release(&frame_table_lock);
+	if (frame == NULL)
+		return false;
+	vm_put_frame(page);
+
+	frame->ref_cnt = 1;
+	frame_attach(frame, page);
+	cow_copies++;
+	return pml4_set_page(pml4, page->va, frame->kva, true);
 }
 
 /* Return true on success */
@@ -288,8 +366,21 @@ vm_handle_wp(struct page *page UNUSED)
 	- true : user에 의한 접근에 해당한다.
 	- false : kernel에 의한 접근에 해당한다.
 */
-bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
-						 bool user UNUSED, bool write UNUSED, bool not_present UNUSED)
+bool vm_try_handle_fault(struct intr_frame *f, void *addr,
+						 bool user, bool write, bool not_present)
+{
+	bool handled;
+
+	trace(TRACE_FAULT, TRACE_BEGIN, (uintptr_t)addr,
+		  (user ? TRACE_FAULT_USER : 0) | (write ? TRACE_FAULT_WRITE : 0) | (not_present ? TRACE_FAULT_NOT_PRESENT : 0));
+	handled = vm_handle_fault(f, addr, user, write, not_present);
+	trace(TRACE_FAULT, TRACE_END, (uintptr_t)addr, handled);
+	return handled;
+}
+
+/* vm_handle_fault - vm_try_handle_fault()의 본체. 처리할 수 있는 폴트이면 페이지를 할당하고 true를 반환한다. */
+static bool vm_handle_fault(struct intr_frame *f, void *addr,
+							bool user, bool write, bool not_present)
 {
 	struct supplemental_page_table *spt UNUSED = &thread_current()->spt;
 	struct page *page = NULL;
@@ -324,11 +415,186 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 			return false;
 		if (write == 1 && page->writable == 0) // write 불가능한 페이지에 write 요청한 경우
 			return false;
+		fault_cnt++;
+		if (vm_try_huge(page))
+			return true;
 		return vm_do_claim_page(page);
 	}
+	// 쓰기 가능한 페이지에 쓰다가 난 보호 폴트는 fork가 공유해 둔 페이지다.
+	if (write)
+	{
+		page = spt_find_page(spt, addr);
+		if (page == NULL || !page->writable)
+			return false;
+		return vm_handle_wp(page);
+	}
+	return false;
+}
+
+/* page_is_zero_anon - PAGE가 아직 프레임이 없고 첫 폴트 때 0으로 채워질 익명 페이지이면 true를 반환한다.
+ * 초기화 함수가 없는 페이지와 파일에서 읽을 바이트가 없는 세그먼트(BSS) 페이지가 해당한다. */
+static bool page_is_zero_anon(struct page *page)
+{
+	struct lazy_load_arg *arg = page->uninit.aux;
+
+	if (page->frame != NULL || VM_TYPE(page->operations->type) != VM_UNINIT || VM_TYPE(page->uninit.type) != VM_ANON)
+		return false;
+	return page->uninit.init == NULL || (page->uninit.init == lazy_load_segment && arg->read_bytes == 0);
+}
+
+/* vm_try_huge - PAGE를 포함하는 2 MB 정렬 영역 전체가 0으로 채워질 익명 페이지이고 쓰기 권한이 같으면,
+ * 영역 전체를 물리적으로 2 MB 정렬된 프레임 하나와 큰 PDE 하나로 한 번에 매핑한다.
+ * 영역의 페이지들은 각자 4 kB 프레임 구조체를 받으므로 나머지 VM 코드는 그대로 동작하고,
+ * 교체할 때만 vm_evict_frame()이 4 kB 페이지로 쪼갠다.
+ * 매핑했으면 true, 조건이 맞지 않거나 메모리가 부족하면 false를 반환한다. 이때는 4 kB 페이지로 처리한다. */
+static bool vm_try_huge(struct page *page)
+{
+	struct thread *curr = thread_current();
+	struct supplemental_page_table *spt = &curr->spt;
+	void *base = (void *)((uint64_t)page->va & ~(LARGE_PGSIZE - 1));
+	struct list frames;
+	struct list_elem *e;
+	uint8_t *kva;
+	size_t i;
+
+	if (!page_is_zero_anon(page))
+		return false;
+	huge_tries++;
+	if (base == spt->huge_miss)
+		return false;
+
+	for (i = 0; i < HUGE_PAGE_CNT; i++)
+	{
+		struct page *p = spt_find_page(spt, (uint8_t *)base + i * PGSIZE);
+		if (p == NULL || !page_is_zero_anon(p) || p->writable != page->writable)
+		{
+			spt->huge_miss = base;
+			return false;
+		}
+	}
+
+	kva = palloc_get_aligned(PAL_USER | PAL_ZERO, HUGE_PAGE_CNT);
+	if (kva == NULL)
+	{
+		spt->huge_miss = base;
+		return false;
+	}
+	list_init(&frames);
+	for (i = 0; i < HUGE_PAGE_CNT; i++)
+	{
+		struct frame *frame = kmem_cache_alloc(frame_cache);
+		if (frame == NULL)
+			goto fail;
+		frame->kva = kva + i * PGSIZE;
+		frame->page = NULL;
+		list_init(&frame->pages);
+		list_push_back(&frames, &frame->frame_elem);
+	}
+	if (!pml4_map_large(curr->pml4, (uint64_t)base, vtop(kva), PTE_U | (page->writable ? PTE_W : 0)))
+	{
+		spt->huge_miss = base;
+		goto fail;
+	}
+
+	/* 페이지마다 프레임을 연결하고 익명 페이지로 초기화한다. 내용은 이미 0이다. */
+	for (i = 0, e = list_begin(&frames); i < HUGE_PAGE_CNT; i++, e = list_next(e))
+	{
+		struct page *p = spt_find_page(spt, (uint8_t *)base + i * PGSIZE);
+		struct frame *frame = list_entry(e, struct frame, frame_elem);
+
+		frame->ref_cnt = 1;
+		frame_attach(frame, p);
+		p->uninit.page_initializer(p, p->uninit.type, frame->kva);
+	}
+	lock_acquire(&frame_table_lock);
+	list_splice(list_end(&frame_table), list_begin(&frames), list_end(&frames));
+	lock_release(&frame_table_lock);
+	huge_maps++;
+	return true;
+
+fail:
+	while (!list_empty(&frames))
+		kmem_cache_free(frame_cache, list_entry(list_pop_front(&frames), struct frame, frame_elem));
+	palloc_free_multiple(kva, HUGE_PAGE_CNT);
 	return false;
 }
 
+/* vm_split_huge - PML4에서 VA가 2 MB 페이지 안에 있으면 4 kB 페이지로 쪼갠다.
+ * 메모리가 부족해서 쪼개지 못하면 false를 반환한다. */
+static bool vm_split_huge(uint64_t *pml4, void *va)
+{
+	uint64_t *pte = pml4e_walk(pml4, (uint64_t)va, 0);
+
+	if (pte == NULL || !is_large_pte(pte))
+		return true;
+	if (!pml4_split_large(pml4, va))
+		return false;
+	huge_splits++;
+	return true;
+}
+
+/* vm_put_frame - PAGE의 매핑을 지우고 프레임과의 연결을 끊는다.
+ * PAGE가 프레임의 주인이었다면 프레임을 아직 매핑한 다른 페이지가 주인이 되므로,
+ * fork한 부모가 먼저 종료해도 자식에게 남은 프레임은 다시 교체 대상이 된다.
+ * 프레임을 매핑한 페이지가 더 없으면 프레임을 해제한다. */
+static void vm_put_frame(struct page *page)
+{
+	struct frame *frame = page->frame;
+	bool last;
+
+	pml4_clear_page(page->pml4, page->va);
+
+	lock_acquire(&frame_table_lock);
+	frame_detach(frame, page);
+	last = --frame->ref_cnt == 0;
+	if (last)
+	{
+		if (clock_ref == &frame->frame_elem)
+			clock_ref = list_next(clock_ref);
+		list_remove(&frame->frame_elem);
+	}
+	lock_release(&frame_table_lock);
+
+	if (last)
+	{
+		palloc_free_page(frame->kva);
+		kmem_cache_free(frame_cache, frame);
+	}
+}
+
+/* frame_attach - PAGE가 FRAME을 매핑했음을 기록한다. FRAME에 주인 페이지가 없으면 PAGE가 주인이 된다.
+ * 참조 수는 호출자가 관리한다. */
+static void frame_attach(struct frame *frame, struct page *page)
+{
+	lock_acquire(&frame_table_lock);
+	page->frame = frame;
+	list_push_back(&frame->pages, &page->map_elem);
+	if (frame->page == NULL)
+		frame->page = page;
+	lock_release(&frame_table_lock);
+}
+
+/* frame_detach - PAGE를 FRAME의 매핑 목록에서 뺀다. PAGE가 주인이었다면 남은 페이지 중 첫 번째에게 넘긴다.
+ * frame_table_lock을 쥔 상태에서 호출되어야 한다. */
+static void frame_detach(struct frame *frame, struct page *page)
+{
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+	ASSERT(page->frame == frame);
+
+	list_remove(&page->map_elem);
+	page->frame = NULL;
+	if (frame->page == page)
+		frame->page = list_empty(&frame->pages) ? NULL : list_entry(list_front(&frame->pages), struct page, map_elem);
+}
+
+/* vm_print_stats - 폴트 수, 2 MB 페이지, 쓰기 시 복사 통계를 출력한다. */
+void vm_print_stats(void)
+{
+	printf("VM: %llu faults, %llu of %llu candidate faults mapped 2 MB pages (%llu%%), %llu huge pages split\n",
+		   fault_cnt, huge_maps, huge_tries, huge_tries ? huge_maps * 100 / huge_tries : 0, huge_splits);
+	printf("VM: %llu pages shared by fork, %llu copied on write\n", cow_shares, cow_copies);
+}
+
 /* Free the page.
 /* DO NOT MODIFY THIS FUNCTION. */
 /* 페이지를 해제합니다. */
@@ -336,7 +602,10 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 void vm_dealloc_page(struct page *page)
 {
 	destroy(page);
-	free(page);
+	/* 프레임은 여러 프로세스가 공유할 수 있으므로 pml4_destroy()가 아니라 여기서 놓는다. */
+	if (page->frame != NULL)
+		vm_put_frame(page);
+	kmem_cache_free(page_cache, page);
 }
 
 /* Claim the page that allocate on VA. */
@@ -368,8 +637,8 @@ vm_do_claim_page(struct page *page)
 	}
 
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	frame->ref_cnt = 1;
+	frame_attach(frame, page);
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
 	/* 페이지 테이블 항목을 삽입하여 페이지의 VA를 프레임의 PA에 매핑합니다. */
@@ -377,11 +646,9 @@ vm_do_claim_page(struct page *page)
 	커널 가상 주소를 반환한다.*/
 	if (pml4_get_page(thread_current()->pml4, page->va) == NULL)
 	{
+		/* 페이지는 SPT에 남아 있으므로 해제하지 않는다. 프레임은 페이지를 해제할 때 함께 놓는다. */
 		if (!pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable))
-		{
-			vm_dealloc_page(page);
 			return false;
-		}
 	}
 	/* 해당 페이지를 물리 메모리에 올려준다.*/
 	return swap_in(page, frame->kva);
@@ -392,6 +659,51 @@ vm_do_claim_page(struct page *page)
 void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED)
 {
 	hash_init(&spt->hash_table, page_hash, page_less, NULL);
+	spt->huge_miss = NULL;
+}
+
+/* spt_owner - SPT를 가진 스레드를 반환한다. */
+static struct thread *spt_owner(struct supplemental_page_table *spt)
+{
+	return (struct thread *)((uint8_t *)spt - offsetof(struct thread, spt));
+}
+
+/* vm_share_page - SRC의 SRC_PAGE가 쓰는 프레임을 DST의 같은 주소에 읽기 전용으로 매핑하고,
+ * SRC 쪽 매핑도 읽기 전용으로 바꾼다. 현재 스레드가 DST를 가진 자식이어야 한다.
+ * 성공하면 true, 메모리가 부족하면 false를 반환한다. */
+static bool vm_share_page(struct supplemental_page_table *dst,
+						  struct supplemental_page_table *src, struct page *src_page)
+{
+	uint64_t *src_pml4 = spt_owner(src)->pml4;
+	struct frame *frame;
+	struct page *dst_page;
+
+	/* 먼저 참조를 더해서 그사이에 교체되지 않게 한다. */
+	lock_acquire(&frame_table_lock);
+	frame = src_page->frame;
+	if (frame != NULL)
+		frame->ref_cnt++;
+	lock_release(&frame_table_lock);
+	if (frame == NULL)
+		return false;
+
+	/* 4 kB 단위로 권한을 바꿔야 하므로 2 MB 페이지는 먼저 쪼갠다. */
+	if (!vm_split_huge(src_pml4, src_page->va) || !vm_alloc_page(VM_ANON, src_page->va, src_page->writable))
+	{
+		lock_acquire(&frame_table_lock);
+		frame->ref_cnt--;
+		lock_release(&frame_table_lock);
+		return false;
+	}
+	/* 이제부터 프레임 참조는 DST_PAGE의 것이므로 실패해도 페이지를 해제할 때 함께 놓인다. */
+	dst_page = spt_find_page(dst, src_page->va);
+	frame_attach(frame, dst_page);
+	if (!swap_in(dst_page, frame->kva) || !pml4_set_page(thread_current()->pml4, dst_page->va, frame->kva, false))
+		return false;
+
+	pml4_set_writable(src_pml4, src_page->va, false);
+	cow_shares++;
+	return true;
 }
 
 /* Copy supplemental page table from src to dst */
@@ -447,9 +759,34 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 		// 	pml4_set_page(thread_current()->pml4, file_page->va, src_page->frame->kva, src_page->writable);
 		// 	continue;
 		// }
+		else if (vm_type == VM_ANON && src_page->frame != NULL)
+		{
+			/* 2) 메모리에 있는 익명 페이지면 프레임을 복사하지 않고 공유한다.
+			 * 양쪽 모두 읽기 전용으로 매핑해 두고, 먼저 쓰는 쪽이 vm_handle_wp()에서 복사한다. */
+			if (!vm_share_page(dst, src, src_page))
+				return false;
+			continue;
+		}
+		else if (vm_type == VM_ANON)
+		{
+			/* 3) 스왑 아웃된 익명 페이지면 스왑 슬롯을 복사해서 자식도 스왑 아웃된 상태로 시작한다.
+			 * 자식이 처음 접근할 때 자기 슬롯에서 읽어 온다. */
+			if (!vm_alloc_page(VM_ANON, va, writable))
+				return false;
+			if (!anon_swap_copy(spt_find_page(dst, va), src_page))
+				return false;
+			continue;
+		}
+		else if (src_page->frame == NULL)
+		{
+			/* 4) 내보낸 파일 페이지는 내보낼 때 파일에 기록했으므로 자식은 파일에서 다시 읽어 온다. */
+			if (!vm_alloc_page_with_initializer(VM_FILE, va, writable, lazy_load_segment, src_page->file.aux))
+				return false;
+			continue;
+		}
 		else{
 
-			/* 2) type이 uninit이 아니면 */
+			/* 5) 그 밖의 페이지는 새 프레임에 바로 복사한다. */
 			if (!vm_alloc_page(vm_type, va, writable)) // uninit page 생성 & 초기화
 				// init이랑 aux는 Lazy Loading에 필요함
 				// 지금 만드는 페이지는 기다리지 않고 바로 내용을 넣어줄 것이므로 필요 없음
@@ -461,7 +798,7 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 
 			// 매핑된 프레임에 내용 로딩
 			struct page *dst_page = spt_find_page(dst, va);
-			memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
+			copy_page(dst_page->frame->kva, src_page->frame->kva);
 		}
 		
 	}